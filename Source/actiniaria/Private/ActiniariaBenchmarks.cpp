@@ -0,0 +1,220 @@
+#include "IPCFrame.h"
+#include "VertexPacker.h"
+#include "NameTable.h"
+#include "PayloadCompressor.h"
+#include "actiniaria.h"
+
+#include "Engine/ReflectionCapture.h"
+#include "Engine/MapBuildDataRegistry.h"
+#include "Engine/Texture2D.h"
+#include "Components/ReflectionCaptureComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "UObject/UObjectIterator.h"
+#include <codecvt>
+#include <locale>
+#include <regex>
+#include <vector>
+
+// benchmarks of code that needs the engine or the loaded assets, run from the editor console.
+// the ones without UE dependency are in Tools/Benchmarks
+
+static void benchmarkVertexPacking(const TArray<FString>& args)
+{
+	UINT numVertices = args.Num() > 0 ? (UINT)FCString::Atoi(*args[0]) : (1U << 20);
+	if (numVertices == 0)
+		return;
+
+	FPositionVertexBuffer positions;
+	FStaticMeshVertexBuffer vertices;
+	FColorVertexBuffer colors;
+	positions.Init(numVertices);
+	vertices.Init(numVertices, 1);
+	colors.Init(numVertices);
+
+	FRandomStream random(0);
+	for (UINT i = 0; i < numVertices; ++i)
+	{
+		FVector normal = random.GetUnitVector();
+		FVector tangent = (random.GetUnitVector() ^ normal).GetSafeNormal();
+		positions.VertexPosition(i) = random.GetUnitVector() * 1000.0f;
+		vertices.SetVertexTangents(i, tangent, normal ^ tangent, normal);
+		vertices.SetVertexUV(i, 0, FVector2D(random.FRand(), random.FRand()));
+		colors.VertexColor(i) = FColor(random.GetUnsignedInt());
+	}
+
+	VertexPacker packer(positions, vertices, colors);
+	std::vector<char> scalar(numVertices * VertexPacker::stride);
+	std::vector<char> simd(numVertices * VertexPacker::stride);
+
+	auto measure = [&](std::vector<char>& dst, bool usesimd)
+	{
+		double best = DBL_MAX;
+		for (int run = 0; run < 5; ++run)
+		{
+			double start = FPlatformTime::Seconds();
+			packer.pack(dst.data(), 0, numVertices, usesimd);
+			best = FMath::Min(best, FPlatformTime::Seconds() - start);
+		}
+		return best * 1000.0;
+	};
+
+	double scalarms = measure(scalar, false);
+	double simdms = measure(simd, true);
+
+	float maxerror = 0;
+	for (UINT i = 0; i < numVertices; ++i)
+	{
+		// every field but the trailing FColor is float
+		auto a = (const float*)(scalar.data() + i * VertexPacker::stride);
+		auto b = (const float*)(simd.data() + i * VertexPacker::stride);
+		for (UINT c = 0; c < (VertexPacker::stride - sizeof(FColor)) / sizeof(float); ++c)
+			maxerror = FMath::Max(maxerror, FMath::Abs(a[c] - b[c]));
+	}
+
+	UE_LOG(LogActiniaria, Display, TEXT("vertex packing %u vertices: scalar %.2f ms, simd %.2f ms (%.2fx), max difference %g"),
+		numVertices, scalarms, simdms, scalarms / FMath::Max(simdms, 1e-6), maxerror);
+
+	positions.CleanUp();
+	vertices.CleanUp();
+	colors.CleanUp();
+}
+
+static FAutoConsoleCommand BenchmarkVertexPackingCommand(
+	TEXT("actiniaria.BenchmarkVertexPacking"),
+	TEXT("Compares scalar and simd vertex packing on synthetic vertex arrays. Usage: actiniaria.BenchmarkVertexPacking [NumVertices]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkVertexPacking));
+
+static void benchmarkNameInterning(const TArray<FString>& args)
+{
+	// names of the loaded objects, each looked up three times like a mesh or material referenced by several models
+	const int32 maxNames = args.Num() > 0 ? FCString::Atoi(*args[0]) : 100000;
+	TArray<FName> names;
+	for (TObjectIterator<UObject> iter; iter && names.Num() < maxNames; ++iter)
+		names.Add(iter->GetFName());
+	const int32 repeats = 3;
+
+	// what every call did before: a new converter with its locale facet and a new regex
+	auto previous = [](FName name)
+	{
+		std::wstring_convert<std::codecvt<wchar_t, char, std::mbstate_t>>
+			converter(new std::codecvt<wchar_t, char, std::mbstate_t>("CHS"));
+		std::regex pattern("[^0-9a-zA-Z_]");
+		return "_" + std::regex_replace(converter.to_bytes(*name.ToString()), pattern, "_");
+	};
+
+	double start = FPlatformTime::Seconds();
+	for (int32 r = 0; r < repeats; ++r)
+	{
+		for (auto& name : names)
+			previous(name);
+	}
+	const double beforems = (FPlatformTime::Seconds() - start) * 1000.0;
+
+	start = FPlatformTime::Seconds();
+	NameTable table;
+	for (int32 r = 0; r < repeats; ++r)
+	{
+		for (auto& name : names)
+			table.getVariable(table.intern(name));
+	}
+	const double afterms = (FPlatformTime::Seconds() - start) * 1000.0;
+
+	int32 mismatches = 0;
+	for (auto& name : names)
+		mismatches += previous(name) != table.getVariable(table.intern(name));
+
+	UE_LOG(LogActiniaria, Display, TEXT("name conversion, %d names x %d: per call %.2f ms, interned %.2f ms (%.2fx), %u table entries, %d mismatched names"),
+		names.Num(), repeats, beforems, afterms, beforems / FMath::Max(afterms, 1e-6), table.getNum(), mismatches);
+}
+
+static FAutoConsoleCommand BenchmarkNameInterningCommand(
+	TEXT("actiniaria.BenchmarkNameInterning"),
+	TEXT("Compares converting and sanitizing the names of loaded objects on every use with the interned name table. Usage: actiniaria.BenchmarkNameInterning [MaxNames]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkNameInterning));
+
+static void benchmarkIPCCompression(const TArray<FString>& args)
+{
+	// payloads as the export builds them: packed lod 0 vertices and indices, first texture mips, reflection captures
+	const int32 maxAssets = args.Num() > 0 ? FCString::Atoi(*args[0]) : 200;
+	const uint32 chunkSize = (uint32)(args.Num() > 1 ? FMath::Max(FCString::Atoi(*args[1]), 1) : 256) << 10;
+	const MeshOptions options = MeshOptions::fromConsoleVariables();
+	const TCHAR* kinds[] = { TEXT("mesh"), TEXT("texture"), TEXT("capture") };
+	std::vector<std::vector<char>> payloads[3];
+
+	for (TObjectIterator<UStaticMesh> iter; iter && (int32)payloads[0].size() < maxAssets * 2; ++iter)
+	{
+		auto renderdata = iter->RenderData.Get();
+		if (renderdata == nullptr || renderdata->LODResources.Num() == 0)
+			continue;
+		auto& lod = renderdata->LODResources[0];
+		VertexPacker packer(lod.VertexBuffers.PositionVertexBuffer, lod.VertexBuffers.StaticMeshVertexBuffer, lod.VertexBuffers.ColorVertexBuffer, options.vertexFormat, &renderdata->Bounds);
+		std::vector<char> vertices((size_t)packer.getStride() * packer.getNumVertices());
+		packer.pack(vertices.data(), 0, packer.getNumVertices(), options.simd);
+		payloads[0].push_back(std::move(vertices));
+
+		auto& indices = lod.IndexBuffer;
+		const size_t indexstride = indices.Is32Bit() ? 4 : 2;
+		std::vector<char> indexData(indices.GetNumIndices() * indexstride);
+		if (!indexData.empty())
+			memcpy(indexData.data(), indices.Is32Bit() ? (const void*)indices.AccessStream32() : (const void*)indices.AccessStream16(), indexData.size());
+		payloads[0].push_back(std::move(indexData));
+	}
+
+	for (TObjectIterator<UTexture2D> iter; iter && (int32)payloads[1].size() < maxAssets; ++iter)
+	{
+		auto mip = IPCFrame::encodeTopMip(*iter);
+		if (!mip.empty())
+			payloads[1].push_back(std::move(mip));
+	}
+
+	for (TObjectIterator<AReflectionCapture> iter; iter && (int32)payloads[2].size() < maxAssets; ++iter)
+	{
+		auto comp = iter->GetCaptureComponent();
+		auto data = comp ? comp->GetMapBuildData() : nullptr;
+		if (data && data->FullHDRCapturedData.Num() > 0)
+			payloads[2].emplace_back((const char*)data->FullHDRCapturedData.GetData(), (const char*)data->FullHDRCapturedData.GetData() + data->FullHDRCapturedData.Num());
+	}
+
+	for (auto codec : { PC_LZ4, PC_Zlib })
+	{
+		const PayloadCompressor compressor(codec, chunkSize, 0);
+		for (int kind = 0; kind < 3; ++kind)
+		{
+			if (payloads[kind].empty())
+				continue;
+
+			uint64 raw = 0, encoded = 0, mismatches = 0;
+			double serial = 0, parallel = 0, decompress = 0;
+			std::vector<char> out, back;
+			for (auto& payload : payloads[kind])
+			{
+				double start = FPlatformTime::Seconds();
+				compressor.compress(payload.data(), (uint32)payload.size(), out, false);
+				serial += FPlatformTime::Seconds() - start;
+
+				start = FPlatformTime::Seconds();
+				compressor.compress(payload.data(), (uint32)payload.size(), out, true);
+				parallel += FPlatformTime::Seconds() - start;
+
+				start = FPlatformTime::Seconds();
+				bool valid = PayloadCompressor::decompress(codec, out.data(), out.size(), back);
+				decompress += FPlatformTime::Seconds() - start;
+
+				mismatches += !valid || back != payload;
+				raw += payload.size();
+				encoded += out.size();
+			}
+
+			const double mb = raw / (1024.0 * 1024.0);
+			UE_LOG(LogActiniaria, Display, TEXT("payload compression %s, %llu %s payloads, %.1f MB: ratio %.2f, serial %.1f MB/s, parallel %.1f MB/s, decompress %.1f MB/s, %llu mismatched payloads"),
+				codec == PC_LZ4 ? TEXT("lz4") : TEXT("zlib"), (uint64)payloads[kind].size(), kinds[kind], mb, raw / (double)FMath::Max(encoded, (uint64)1),
+				mb / FMath::Max(serial, 1e-9), mb / FMath::Max(parallel, 1e-9), mb / FMath::Max(decompress, 1e-9), mismatches);
+		}
+	}
+}
+
+static FAutoConsoleCommand BenchmarkIPCCompressionCommand(
+	TEXT("actiniaria.BenchmarkIPCCompression"),
+	TEXT("Compresses the meshes, textures and reflection captures of loaded assets with every payload codec and logs ratio and throughput. Usage: actiniaria.BenchmarkIPCCompression [MaxAssets] [ChunkSizeKB]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkIPCCompression));
@@ -0,0 +1,55 @@
+#include "BatchWriter.h"
+
+BatchWriter::BatchWriter(Sink sink, size_t flushSize, size_t bypassSize, std::chrono::microseconds maxLatency):
+	mSink(std::move(sink)), mFlushSize(flushSize), mBypassSize(bypassSize), mMaxLatency(maxLatency)
+{
+	mBuffer.reserve(flushSize);
+}
+
+BatchWriter::~BatchWriter()
+{
+	flush();
+}
+
+void BatchWriter::write(const void* data, size_t size)
+{
+	++mNumWrites;
+	mNumBytes += size;
+	if (size == 0)
+		return;
+
+	// large payloads would only be copied once more, the order is kept by flushing first
+	if (mFlushSize == 0 || size >= mBypassSize)
+	{
+		flush();
+		emit(data, size);
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (mBuffer.empty())
+		mOldest = now;
+	else if (now - mOldest >= mMaxLatency)
+	{
+		flush();
+		mOldest = now;
+	}
+
+	mBuffer.insert(mBuffer.end(), (const char*)data, (const char*)data + size);
+	if (mBuffer.size() >= mFlushSize)
+		flush();
+}
+
+void BatchWriter::flush()
+{
+	if (mBuffer.empty())
+		return;
+	emit(mBuffer.data(), mBuffer.size());
+	mBuffer.clear();
+}
+
+void BatchWriter::emit(const void* data, size_t size)
+{
+	++mNumSinkWrites;
+	mSink(data, size);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// coalesces the small writes of one thread into few large writes to the sink.
+// writes of at least bypassSize bytes go to the sink directly after what is buffered, they are not copied.
+// the buffer is flushed when it reaches flushSize bytes or when a write comes maxLatency after the oldest buffered byte,
+// the owner flushes before it waits for the other side. no UE dependency, Tools builds it for its test and benchmark.
+class BatchWriter
+{
+public:
+	typedef std::function<void(const void* data, size_t size)> Sink;
+
+	// a flushSize of 0 passes every write through
+	BatchWriter(Sink sink, size_t flushSize, size_t bypassSize, std::chrono::microseconds maxLatency);
+	~BatchWriter();
+	BatchWriter(const BatchWriter&) = delete;
+	BatchWriter& operator=(const BatchWriter&) = delete;
+
+	void write(const void* data, size_t size);
+	void flush();
+
+	// calls of the sink so far, each is at least one write to the pipe
+	uint64_t getNumSinkWrites() const { return mNumSinkWrites; }
+	uint64_t getNumWrites() const { return mNumWrites; }
+	uint64_t getNumBytes() const { return mNumBytes; }
+private:
+	void emit(const void* data, size_t size);
+
+	Sink mSink;
+	std::vector<char> mBuffer;
+	size_t mFlushSize;
+	size_t mBypassSize;
+	std::chrono::microseconds mMaxLatency;
+	std::chrono::steady_clock::time_point mOldest;
+	uint64_t mNumSinkWrites = 0;
+	uint64_t mNumWrites = 0;
+	uint64_t mNumBytes = 0;
+};
@@ -0,0 +1,308 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+static void writeLE(uint8_t* dst, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+		dst[i] = (uint8_t)(value >> (i * 8));
+}
+
+static uint16_t to565(const float* c)
+{
+	int r = std::min(std::max((int)(c[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+	int g = std::min(std::max((int)(c[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+	int b = std::min(std::max((int)(c[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void from565(uint16_t v, int* c)
+{
+	int r = (v >> 11) & 31;
+	int g = (v >> 5) & 63;
+	int b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+// picks the nearest of the 4 palette colors for every pixel, returns the squared error.
+// c0 > c1 on return so the block decodes in 4 color mode, which BC3 assumes as well
+static uint32_t fitIndices(const uint8_t* rgba, uint16_t& c0, uint16_t& c1, uint32_t& indices)
+{
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	int palette[4][3];
+	from565(c0, palette[0]);
+	from565(c1, palette[1]);
+	for (int k = 0; k < 3; ++k)
+	{
+		palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+		palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+	}
+	// equal endpoints decode in 3 color mode, index 0 is still the endpoint
+	int numColors = c0 == c1 ? 1 : 4;
+
+	uint32_t error = 0;
+	indices = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		const uint8_t* p = rgba + i * 4;
+		uint32_t best = 0;
+		uint32_t bestError = ~0u;
+		for (int j = 0; j < numColors; ++j)
+		{
+			int dr = p[0] - palette[j][0];
+			int dg = p[1] - palette[j][1];
+			int db = p[2] - palette[j][2];
+			uint32_t e = (uint32_t)(dr * dr + dg * dg + db * db);
+			if (e < bestError)
+			{
+				bestError = e;
+				best = (uint32_t)j;
+			}
+		}
+		indices |= best << (i * 2);
+		error += bestError;
+	}
+	return error;
+}
+
+// least squares endpoints for fixed indices, false if all pixels use the same weight
+static bool refineEndpoints(const uint8_t* rgba, uint32_t indices, float* a, float* b)
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0, bb = 0, ab = 0;
+	float ax[3] = { 0, 0, 0 };
+	float bx[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		float w = weights[(indices >> (i * 2)) & 3];
+		float v = 1.0f - w;
+		aa += w * w;
+		bb += v * v;
+		ab += w * v;
+		for (int k = 0; k < 3; ++k)
+		{
+			ax[k] += w * rgba[i * 4 + k];
+			bx[k] += v * rgba[i * 4 + k];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if (std::fabs(det) < 1e-6f)
+		return false;
+	float inv = 1.0f / det;
+	for (int k = 0; k < 3; ++k)
+	{
+		a[k] = std::min(std::max((ax[k] * bb - bx[k] * ab) * inv, 0.0f), 255.0f);
+		b[k] = std::min(std::max((bx[k] * aa - ax[k] * ab) * inv, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+void BlockCompressor::encodeBC1(const uint8_t* rgba, uint8_t* dst)
+{
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+			mean[k] += rgba[i * 4 + k];
+	}
+	for (int k = 0; k < 3; ++k)
+		mean[k] /= 16.0f;
+
+	float cov[3][3] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		float d[3];
+		for (int k = 0; k < 3; ++k)
+			d[k] = rgba[i * 4 + k] - mean[k];
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+				cov[r][c] += d[r] * d[c];
+		}
+	}
+
+	// principal axis by power iteration, the extreme pixels along it are the initial endpoints.
+	// it starts from the covariance column of the widest channel, a fixed start like (1, 1, 1) can be orthogonal to the
+	// axis and then finds nothing, e.g. for a gradient from orange to cyan
+	int widest = 0;
+	for (int k = 1; k < 3; ++k)
+	{
+		if (cov[k][k] > cov[widest][widest])
+			widest = k;
+	}
+	float axis[3] = { cov[0][widest], cov[1][widest], cov[2][widest] };
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		float next[3];
+		for (int r = 0; r < 3; ++r)
+			next[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+		float scale = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+		if (scale < 1e-6f)
+			break;
+		for (int k = 0; k < 3; ++k)
+			axis[k] = next[k] / scale;
+	}
+
+	int minIndex = 0;
+	int maxIndex = 0;
+	float minDot = 1e30f;
+	float maxDot = -1e30f;
+	for (int i = 0; i < 16; ++i)
+	{
+		const uint8_t* p = rgba + i * 4;
+		float d = (p[0] - mean[0]) * axis[0] + (p[1] - mean[1]) * axis[1] + (p[2] - mean[2]) * axis[2];
+		if (d < minDot)
+		{
+			minDot = d;
+			minIndex = i;
+		}
+		if (d > maxDot)
+		{
+			maxDot = d;
+			maxIndex = i;
+		}
+	}
+
+	float a[3];
+	float b[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		a[k] = rgba[maxIndex * 4 + k];
+		b[k] = rgba[minIndex * 4 + k];
+	}
+
+	uint16_t c0 = to565(a);
+	uint16_t c1 = to565(b);
+	uint32_t indices;
+	uint32_t error = fitIndices(rgba, c0, c1, indices);
+
+	if (error > 0 && refineEndpoints(rgba, indices, a, b))
+	{
+		uint16_t r0 = to565(a);
+		uint16_t r1 = to565(b);
+		uint32_t refined;
+		if (fitIndices(rgba, r0, r1, refined) < error)
+		{
+			c0 = r0;
+			c1 = r1;
+			indices = refined;
+		}
+	}
+
+	writeLE(dst, c0, 2);
+	writeLE(dst + 2, c1, 2);
+	writeLE(dst + 4, indices, 4);
+}
+
+void BlockCompressor::encodeBC4(const uint8_t* values, uint8_t* dst)
+{
+	int lo = 255;
+	int hi = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		lo = std::min(lo, (int)values[i]);
+		hi = std::max(hi, (int)values[i]);
+	}
+
+	// hi > lo selects the 8 value mode, palette 0 = hi, 1 = lo, 2..7 interpolate from hi to lo
+	uint64_t bits = 0;
+	int range = hi - lo;
+	if (range > 0)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int step = ((hi - values[i]) * 14 + range) / (2 * range);
+			uint64_t index = step == 0 ? 0 : step == 7 ? 1 : (uint64_t)step + 1;
+			bits |= index << (i * 3);
+		}
+	}
+
+	dst[0] = (uint8_t)hi;
+	dst[1] = (uint8_t)lo;
+	writeLE(dst + 2, bits, 6);
+}
+
+void BlockCompressor::encodeBC3(const uint8_t* rgba, uint8_t* dst)
+{
+	uint8_t alpha[16];
+	for (int i = 0; i < 16; ++i)
+		alpha[i] = rgba[i * 4 + 3];
+	encodeBC4(alpha, dst);
+	encodeBC1(rgba, dst + 8);
+}
+
+void BlockCompressor::encodeBC5(const uint8_t* rgba, uint8_t* dst)
+{
+	uint8_t red[16];
+	uint8_t green[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		red[i] = rgba[i * 4 + 0];
+		green[i] = rgba[i * 4 + 1];
+	}
+	encodeBC4(red, dst);
+	encodeBC4(green, dst + 8);
+}
+
+uint32_t BlockCompressor::getBlockSize(Format format)
+{
+	return format == BC1 || format == BC4 ? 8 : 16;
+}
+
+bool BlockCompressor::hasAlpha(const uint8_t* bgra, size_t numPixels)
+{
+	for (size_t i = 0; i < numPixels; ++i)
+	{
+		if (bgra[i * 4 + 3] != 255)
+			return true;
+	}
+	return false;
+}
+
+void BlockCompressor::compress(const uint8_t* bgra, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t numRows, uint8_t* dst) const
+{
+	uint32_t blockSize = getBlockSize(mFormat);
+	uint32_t lastRow = std::min(firstRow + numRows, getNumBlocks(height));
+	for (uint32_t row = firstRow; row < lastRow; ++row)
+	{
+		for (uint32_t bx = 0; bx < getNumBlocks(width); ++bx)
+		{
+			uint8_t block[64];
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint8_t* src = bgra + (size_t)std::min(row * 4 + y, height - 1) * width * 4;
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint8_t* s = src + std::min(bx * 4 + x, width - 1) * 4;
+					uint8_t* p = block + (y * 4 + x) * 4;
+					p[0] = s[2];
+					p[1] = s[1];
+					p[2] = s[0];
+					p[3] = s[3];
+				}
+			}
+
+			switch (mFormat)
+			{
+			case BC1: encodeBC1(block, dst); break;
+			case BC3: encodeBC3(block, dst); break;
+			case BC5: encodeBC5(block, dst); break;
+			case BC4:
+			{
+				uint8_t red[16];
+				for (int i = 0; i < 16; ++i)
+					red[i] = block[i * 4];
+				encodeBC4(red, dst);
+				break;
+			}
+			}
+			dst += blockSize;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// cpu encoder for the BCn block formats of exported textures.
+// every 4x4 block is encoded on its own, so callers can split an image into block rows and encode them in parallel.
+// no UE dependency, Tools/Tests checks the blocks it encodes against a reference decoder.
+class BlockCompressor
+{
+public:
+	enum Format : uint32_t
+	{
+		// rgb, 1 bit alpha is not used, 8 bytes per block
+		BC1,
+		// rgb + interpolated alpha, 16 bytes per block
+		BC3,
+		// single channel, 8 bytes per block
+		BC4,
+		// two channels, used for tangent space normals, 16 bytes per block
+		BC5,
+	};
+
+	explicit BlockCompressor(Format format) : mFormat(format) {}
+
+	// encodes block rows [firstRow, firstRow + numRows) of a BGRA8 image to dst, dst must hold numRows * getRowSize(width) bytes.
+	// blocks on the right and bottom edge of images that are not a multiple of 4 repeat the last pixel
+	void compress(const uint8_t* bgra, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t numRows, uint8_t* dst) const;
+
+	static uint32_t getBlockSize(Format format);
+	static uint32_t getNumBlocks(uint32_t size) { return (size + 3) / 4; }
+	uint32_t getRowSize(uint32_t width) const { return getNumBlocks(width) * getBlockSize(mFormat); }
+	Format getFormat() const { return mFormat; }
+
+	// true if any pixel of the BGRA8 image has alpha below 255
+	static bool hasAlpha(const uint8_t* bgra, size_t numPixels);
+
+	// single block encoders, rgba is 16 pixels in RGBA order, values 16 bytes
+	static void encodeBC1(const uint8_t* rgba, uint8_t* dst);
+	static void encodeBC3(const uint8_t* rgba, uint8_t* dst);
+	static void encodeBC4(const uint8_t* values, uint8_t* dst);
+	static void encodeBC5(const uint8_t* rgba, uint8_t* dst);
+private:
+	Format mFormat;
+};
@@ -0,0 +1,183 @@
+#include "ExportCache.h"
+#include "actiniaria.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+// bump when the layout of any cached payload, the output of an encoder or the generated shader text changes
+static const uint32 CACHE_VERSION = 6;
+static const uint32 CACHE_MAGIC = 0x48434341; // "ACCH"
+
+struct CacheFileHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint64 size;
+};
+
+CacheKey::CacheKey(const TCHAR* kind):
+	mKind(kind)
+{
+	*this << CACHE_VERSION;
+}
+
+CacheKey& CacheKey::operator<<(const FString& value)
+{
+	mHash.UpdateWithString(*value, value.Len());
+	return *this;
+}
+
+CacheKey& CacheKey::operator<<(const std::string& value)
+{
+	mHash.Update((const uint8*)value.data(), value.size());
+	return *this;
+}
+
+FString CacheKey::finalize()
+{
+	mHash.Final();
+	uint8 hash[20];
+	mHash.GetHash(hash);
+	return mKind + TEXT("_") + BytesToHex(hash, sizeof(hash));
+}
+
+CacheWriter& CacheWriter::operator<<(const std::string& value)
+{
+	*this << (uint32)value.size();
+	append(value.data(), value.size());
+	return *this;
+}
+
+CacheWriter& CacheWriter::operator<<(const std::vector<char>& value)
+{
+	*this << (uint64)value.size();
+	append(value.data(), value.size());
+	return *this;
+}
+
+void CacheWriter::append(const void* data, size_t size)
+{
+	auto begin = (const char*)data;
+	mData.insert(mData.end(), begin, begin + size);
+}
+
+CacheReader& CacheReader::operator>>(std::string& value)
+{
+	uint32 size = 0;
+	*this >> size;
+	if (!mValid || (uint64)(mEnd - mData) < size)
+	{
+		mValid = false;
+		return *this;
+	}
+	value.assign(mData, size);
+	mData += size;
+	return *this;
+}
+
+CacheReader& CacheReader::operator>>(std::vector<char>& value)
+{
+	uint64 size = 0;
+	*this >> size;
+	if (!mValid || (uint64)(mEnd - mData) < size)
+	{
+		mValid = false;
+		return *this;
+	}
+	value.assign(mData, mData + size);
+	mData += size;
+	return *this;
+}
+
+void CacheReader::read(void* data, size_t size)
+{
+	if (!mValid || (size_t)(mEnd - mData) < size)
+	{
+		mValid = false;
+		FMemory::Memzero(data, size);
+		return;
+	}
+	memcpy(data, mData, size);
+	mData += size;
+}
+
+ExportCache::ExportCache(const FString& directory):
+	mDirectory(directory)
+{
+	IFileManager::Get().MakeDirectory(*mDirectory, true);
+}
+
+FString ExportCache::getDefaultDirectory()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("actiniaria"), TEXT("ExportCache"));
+}
+
+FString ExportCache::getPath(const FString& key) const
+{
+	return FPaths::Combine(mDirectory, key + TEXT(".bin"));
+}
+
+bool ExportCache::load(const FString& key, const TFunctionRef<bool(const char* data, uint64 size)>& reader) const
+{
+	FString path = getPath(key);
+	auto check = [&](const char* data, uint64 size)
+	{
+		if (size < sizeof(CacheFileHeader))
+			return false;
+		auto header = (const CacheFileHeader*)data;
+		if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION || header->size != size - sizeof(CacheFileHeader))
+			return false;
+		return reader(data + sizeof(CacheFileHeader), header->size);
+	};
+
+	// entries are read in place from a mapping, large payloads are not staged through another buffer
+	TUniquePtr<IMappedFileHandle> handle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*path));
+	if (handle)
+	{
+		TUniquePtr<IMappedFileRegion> region(handle->MapRegion());
+		if (region)
+			return check((const char*)region->GetMappedPtr(), (uint64)region->GetMappedSize());
+	}
+
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *path, FILEREAD_Silent))
+		return false;
+	return check((const char*)bytes.GetData(), (uint64)bytes.Num());
+}
+
+bool ExportCache::load(const FString& key, std::vector<char>& data) const
+{
+	return load(key, [&data](const char* src, uint64 size)
+	{
+		data.assign(src, src + size);
+		return true;
+	});
+}
+
+void ExportCache::store(const FString& key, const void* data, uint64 size) const
+{
+	FString path = getPath(key);
+	FString temp = path + FString::Printf(TEXT(".%u.tmp"), FPlatformTLS::GetCurrentThreadId());
+
+	TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*temp, FILEWRITE_Silent));
+	if (!writer)
+	{
+		UE_LOG(LogActiniaria, Warning, TEXT("cannot write export cache entry %s"), *temp);
+		return;
+	}
+
+	CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, size };
+	writer->Serialize(&header, sizeof(header));
+	writer->Serialize(const_cast<void*>(data), (int64)size);
+	bool ok = writer->Close();
+	writer.Reset();
+
+	if (!ok || !IFileManager::Get().Move(*path, *temp, true, true, false, true))
+	{
+		IFileManager::Get().Delete(*temp, false, false, true);
+		UE_LOG(LogActiniaria, Warning, TEXT("cannot write export cache entry %s"), *path);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Core.h"
+#include "Misc/SecureHash.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// hash of the source data an export payload is built from, used as the ExportCache key
+class CacheKey
+{
+public:
+	explicit CacheKey(const TCHAR* kind);
+
+	CacheKey& operator<<(const FString& value);
+	CacheKey& operator<<(const std::string& value);
+
+	template<class T>
+	CacheKey& operator<<(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "hash plain values only");
+		mHash.Update((const uint8*)&value, sizeof(T));
+		return *this;
+	}
+
+	FString finalize();
+private:
+	FString mKind;
+	FSHA1 mHash;
+};
+
+// serialization of cached payloads
+class CacheWriter
+{
+public:
+	template<class T>
+	CacheWriter& operator<<(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "write plain values only");
+		append(&value, sizeof(T));
+		return *this;
+	}
+
+	CacheWriter& operator<<(const std::string& value);
+	CacheWriter& operator<<(const std::vector<char>& value);
+
+	void append(const void* data, size_t size);
+	const std::vector<char>& getData() const { return mData; }
+private:
+	std::vector<char> mData;
+};
+
+class CacheReader
+{
+public:
+	CacheReader(const char* data, uint64 size) : mData(data), mEnd(data + size) {}
+
+	template<class T>
+	CacheReader& operator>>(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "read plain values only");
+		read(&value, sizeof(T));
+		return *this;
+	}
+
+	CacheReader& operator>>(std::string& value);
+	CacheReader& operator>>(std::vector<char>& value);
+
+	void read(void* data, size_t size);
+	// false once a read ran past the end of the blob
+	bool isValid() const { return mValid; }
+private:
+	const char* mData;
+	const char* mEnd;
+	bool mValid = true;
+};
+
+// on-disk cache of packed export payloads, keyed by CacheKey.
+// safe to use from worker threads, every entry is one file written through a temporary
+class ExportCache
+{
+public:
+	explicit ExportCache(const FString& directory);
+
+	static FString getDefaultDirectory();
+
+	// maps the entry and hands it to reader, returns false on a miss or if reader rejects the data
+	bool load(const FString& key, const TFunctionRef<bool(const char* data, uint64 size)>& reader) const;
+	bool load(const FString& key, std::vector<char>& data) const;
+	void store(const FString& key, const void* data, uint64 size) const;
+private:
+	FString getPath(const FString& key) const;
+private:
+	FString mDirectory;
+};
@@ -0,0 +1,198 @@
+#include "ExportJob.h"
+#include "IPCFrame.h"
+#include "actiniaria.h"
+
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+#include "Async/Async.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/MinWindows.h"
+#endif
+
+#define LOCTEXT_NAMESPACE "FactiniariaModule"
+
+// how long a cancelled worker gets to leave a blocking listen or read before it is left behind
+static const double CANCEL_GRACE_SECONDS = 2.0;
+
+static void destroyFrame(IPCFrame* frame)
+{
+	// releases the references of the snapshot, which has to happen on the game thread
+	if (IsInGameThread())
+		delete frame;
+	else
+		AsyncTask(ENamedThreads::GameThread, [frame]() { delete frame; });
+}
+
+ExportJob::ExportJob(TFunction<void(IPCFrame&)> configure, bool keepFrame):
+	mState(std::make_shared<State>()),
+	mKeepFrame(keepFrame)
+{
+	mState->frame = new IPCFrame();
+	mState->progress = std::make_unique<ExportProgress>();
+	if (configure)
+		configure(*mState->frame);
+	mState->frame->capture();
+
+	FNotificationInfo info(LOCTEXT("ExportWaiting", "actiniaria: waiting for render station"));
+	info.bFireAndForget = false;
+	info.ExpireDuration = 3.0f;
+	info.ButtonDetails.Add(FNotificationButtonInfo(
+		LOCTEXT("ExportCancel", "Cancel"),
+		LOCTEXT("ExportCancelTooltip", "Stop sending the scene to the render station"),
+		FSimpleDelegate::CreateRaw(this, &ExportJob::cancel),
+		SNotificationItem::CS_Pending));
+	mNotification = FSlateNotificationManager::Get().AddNotification(info);
+	if (mNotification.IsValid())
+		mNotification->SetCompletionState(SNotificationItem::CS_Pending);
+
+	mThread = std::thread([state = mState]() { run(state); });
+	mTicker = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &ExportJob::tick), 0.1f);
+}
+
+ExportJob::~ExportJob()
+{
+	cancel();
+	if (mTicker.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(mTicker);
+		mTicker.Reset();
+	}
+	// the editor may be shutting down, it must not wait for a render station that never connects
+	while (!mState->done && FPlatformTime::Seconds() - mCancelTime < CANCEL_GRACE_SECONDS)
+	{
+		FPlatformProcess::Sleep(0.01f);
+		interrupt();
+	}
+	finish();
+	if (!mAbandoned && mState->frame)
+	{
+		destroyFrame(mState->frame);
+		mState->frame = nullptr;
+	}
+}
+
+std::unique_ptr<IPCFrame> ExportJob::releaseFrame()
+{
+	if (isRunning() || mAbandoned)
+		return nullptr;
+	std::unique_ptr<IPCFrame> frame(mState->frame);
+	mState->frame = nullptr;
+	return frame;
+}
+
+void ExportJob::cancel()
+{
+	if (!mState->progress->cancelled)
+		mCancelTime = FPlatformTime::Seconds();
+	mState->progress->cancelled = true;
+	interrupt();
+}
+
+void ExportJob::interrupt()
+{
+#if PLATFORM_WINDOWS
+	// the pipe is used synchronously, cancelling the pending io makes listen and reads fail
+	if (mThread.joinable())
+		::CancelSynchronousIo((HANDLE)mThread.native_handle());
+#endif
+}
+
+void ExportJob::run(const std::shared_ptr<State>& state)
+{
+	try
+	{
+		state->succeeded = state->frame->send(state->progress.get()) && state->frame->serveRequests(*state->progress);
+	}
+	catch (...)
+	{
+		if (!state->progress->cancelled)
+			UE_LOG(LogActiniaria, Error, TEXT("scene export failed, connection to the render station lost"));
+	}
+
+	std::lock_guard<std::mutex> lock(state->mutex);
+	state->done = true;
+	if (state->abandoned)
+		destroyFrame(state->frame);
+}
+
+bool ExportJob::tick(float delta)
+{
+	auto& progress = *mState->progress;
+	if (!mState->done)
+	{
+		if (progress.cancelled)
+		{
+			// the worker may have entered a blocking call after the last interrupt
+			interrupt();
+			if (FPlatformTime::Seconds() - mCancelTime < CANCEL_GRACE_SECONDS)
+				return true;
+		}
+		else
+		{
+			if (mNotification.IsValid() && progress.streaming)
+			{
+				mNotification->SetText(FText::Format(LOCTEXT("ExportStreaming", "actiniaria: scene exported, serving the render station ({0} texture requests)"),
+					FText::AsNumber(progress.served.load())));
+			}
+			else if (mNotification.IsValid() && progress.connected)
+			{
+				mNotification->SetText(FText::Format(LOCTEXT("ExportProgress", "actiniaria: exporting scene {0}/{1}"),
+					FText::AsNumber(progress.completed.load()), FText::AsNumber(progress.total.load())));
+			}
+			return true;
+		}
+	}
+
+	mTicker.Reset();
+	finish();
+	return false;
+}
+
+void ExportJob::finish()
+{
+	// a worker still blocked after being cancelled is left behind, it deletes the frame once the call returns
+	if (mThread.joinable())
+	{
+		std::lock_guard<std::mutex> lock(mState->mutex);
+		mAbandoned = !mState->done;
+		mState->abandoned = mAbandoned;
+		if (mAbandoned)
+			mThread.detach();
+	}
+	if (mThread.joinable())
+		mThread.join();
+
+	auto& progress = *mState->progress;
+	if (mNotification.IsValid())
+	{
+		if (progress.streaming && progress.cancelled)
+		{
+			// the scene itself was complete
+			mNotification->SetText(LOCTEXT("ExportStreamingStopped", "actiniaria: texture streaming stopped"));
+			mNotification->SetCompletionState(SNotificationItem::CS_Success);
+		}
+		else if (mState->succeeded && !mAbandoned)
+		{
+			mNotification->SetText(LOCTEXT("ExportDone", "actiniaria: scene exported"));
+			mNotification->SetCompletionState(SNotificationItem::CS_Success);
+		}
+		else
+		{
+			mNotification->SetText(progress.cancelled ?
+				LOCTEXT("ExportCancelled", "actiniaria: export cancelled") :
+				LOCTEXT("ExportFailed", "actiniaria: export failed"));
+			mNotification->SetCompletionState(SNotificationItem::CS_Fail);
+		}
+		mNotification->ExpireAndFadeout();
+		mNotification.Reset();
+	}
+
+	if (!mAbandoned && mState->frame && !(mKeepFrame && mState->succeeded))
+	{
+		destroyFrame(mState->frame);
+		mState->frame = nullptr;
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
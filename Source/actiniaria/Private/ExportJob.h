@@ -0,0 +1,58 @@
+#pragma once
+#include "Core.h"
+#include "Containers/Ticker.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class IPCFrame;
+struct ExportProgress;
+class SNotificationItem;
+
+// full scene export. the scene is captured on the game thread when the job is created,
+// packing and sending run on a worker thread while a notification shows the progress
+class ExportJob
+{
+public:
+	// configure sets up the frame before the scene is captured. with keepFrame the frame of a successful export is
+	// kept for releaseFrame
+	explicit ExportJob(TFunction<void(IPCFrame&)> configure = nullptr, bool keepFrame = false);
+	// cancels and waits a short time for the worker, a worker blocked on the render station is left behind
+	~ExportJob();
+
+	void cancel();
+	// true until the worker finished and the result was reported, game thread only
+	bool isRunning() const { return mTicker.IsValid(); }
+	// the connected frame after a successful export with keepFrame, null otherwise. game thread only
+	std::unique_ptr<IPCFrame> releaseFrame();
+private:
+	// shared with the worker, which outlives the job when it is left behind
+	struct State
+	{
+		IPCFrame* frame = nullptr;
+		std::unique_ptr<ExportProgress> progress;
+		std::atomic<bool> done{ false };
+		std::atomic<bool> succeeded{ false };
+		// guards done against abandoned, whoever comes second deletes the frame on the game thread
+		std::mutex mutex;
+		bool abandoned = false;
+	};
+
+	bool tick(float delta);
+	static void run(const std::shared_ptr<State>& state);
+	// interrupts a blocking listen or read of the worker, it then sees the cancel flag
+	void interrupt();
+	void finish();
+
+private:
+	std::shared_ptr<State> mState;
+	std::thread mThread;
+	double mCancelTime = 0;
+	bool mKeepFrame = false;
+	// the worker was left behind and deletes the frame itself
+	bool mAbandoned = false;
+	TSharedPtr<SNotificationItem> mNotification;
+	FDelegateHandle mTicker;
+};
@@ -15,114 +15,357 @@
 #include "Engine/ReflectionCapture.h"
 #include "Components/ReflectionCaptureComponent.h"
 #include "Engine/MapBuildDataRegistry.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
 
 #include "MaterialParser.h"
+#include "MaterialCompiler.h"
+#include "VertexPacker.h"
+#include "SharedArena.h"
+#include "Protocol.h"
+#include "BatchWriter.h"
+#include "PayloadCompressor.h"
+#include "ExportCache.h"
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+#include "TextureConverter.h"
+#include "actiniaria.h"
 #include <string>
-#include <regex>
-#include <locale>
+#include <tuple>
+#include <algorithm>
 #include <dxgi.h>
 
 
-static std::string convert(const std::wstring& str)
+static TAutoConsoleVariable<int32> CVarSIMDVertexPacking(
+	TEXT("actiniaria.SIMDVertexPacking"),
+	1,
+	TEXT("Pack mesh vertices with the simd kernels (1) or the scalar fallback (0)."));
+
+static TAutoConsoleVariable<int32> CVarVertexFormat(
+	TEXT("actiniaria.VertexFormat"),
+	0,
+	TEXT("Vertex layout of exported meshes.\n")
+	TEXT(" 0: full float layout, 60 bytes\n")
+	TEXT(" 1: compact, half uv and 10:10:10:2 normal/tangent with binormal sign, 28 bytes\n")
+	TEXT(" 2: compact with positions quantized to 16 bit relative to the mesh bounds, 24 bytes"));
+
+static TAutoConsoleVariable<int32> CVarMaxLODs(
+	TEXT("actiniaria.MaxLODs"),
+	0,
+	TEXT("Number of LODs exported per mesh, starting from LOD0. 0 exports all LODs."));
+
+static TAutoConsoleVariable<int32> CVarNarrowIndices(
+	TEXT("actiniaria.NarrowIndices"),
+	1,
+	TEXT("Send 32 bit index buffers of meshes with less than 65536 vertices as 16 bit indices."));
+
+static TAutoConsoleVariable<int32> CVarValidateIndexNarrowing(
+	TEXT("actiniaria.ValidateIndexNarrowing"),
+	0,
+	TEXT("Check that narrowed 16 bit index buffers round trip to the source indices, falls back to 32 bit on mismatch."));
+
+static TAutoConsoleVariable<int32> CVarInstancedExport(
+	TEXT("actiniaria.InstancedExport"),
+	1,
+	TEXT("Group models sharing mesh and materials into createInstances batches (1) or send one createModel per instance (0)."));
+
+static TAutoConsoleVariable<int32> CVarExportCache(
+	TEXT("actiniaria.ExportCache"),
+	1,
+	TEXT("Reuse packed meshes, texture mips and generated shaders from Saved/actiniaria/ExportCache when their source is unchanged."));
+
+static TAutoConsoleVariable<int32> CVarSharedMemoryTransport(
+	TEXT("actiniaria.SharedMemoryTransport"),
+	1,
+	TEXT("Send bulk payloads through a shared memory arena (1) or inline through the pipe (0)."));
+
+static TAutoConsoleVariable<int32> CVarSharedMemorySizeMB(
+	TEXT("actiniaria.SharedMemorySizeMB"),
+	256,
+	TEXT("Size of the shared memory arena in MB, payloads larger than the arena are sent inline."));
+
+static TAutoConsoleVariable<int32> CVarIPCBatchSizeKB(
+	TEXT("actiniaria.IPCBatchSizeKB"),
+	64,
+	TEXT("Messages and small payloads are collected and written to the pipe in chunks of this size in KB, larger payloads are written directly. 0 writes every message on its own."));
+
+static TAutoConsoleVariable<int32> CVarIPCBatchLatencyMs(
+	TEXT("actiniaria.IPCBatchLatencyMs"),
+	10,
+	TEXT("Longest time in ms a message waits in a partly filled batch while further messages are written."));
+
+static TAutoConsoleVariable<int32> CVarIPCCompression(
+	TEXT("actiniaria.IPCCompression"),
+	0,
+	TEXT("Codecs offered to the render station for payloads, it picks one or none in the handshake. 0: none, 1: lz4, 2: zlib, 3: lz4 and zlib. Mostly costs time with the shared memory transport."));
+
+static TAutoConsoleVariable<int32> CVarIPCCompressionChunkKB(
+	TEXT("actiniaria.IPCCompressionChunkKB"),
+	256,
+	TEXT("Payloads are compressed in independent chunks of this size in KB on worker threads."));
+
+static TAutoConsoleVariable<int32> CVarIPCCompressionMinKB(
+	TEXT("actiniaria.IPCCompressionMinKB"),
+	4,
+	TEXT("Payloads smaller than this in KB are sent uncompressed."));
+
+static TAutoConsoleVariable<int32> CVarTextureCompression(
+	TEXT("actiniaria.TextureCompression"),
+	1,
+	TEXT("Block compress BGRA8 textures before sending them, BC5 for normal maps and BC1 or BC3 (with alpha) for the rest."));
+
+static TAutoConsoleVariable<int32> CVarTextureMips(
+	TEXT("actiniaria.TextureMips"),
+	1,
+	TEXT("Send the full mip chain of textures, mips missing in the source are generated with a box filter. 0 sends mip 0 only."));
+
+static TAutoConsoleVariable<int32> CVarTextureStreaming(
+	TEXT("actiniaria.TextureStreaming"),
+	1,
+	TEXT("Send only the small tail mips with createTexture and serve the larger mips when the render station requests them."));
+
+static TAutoConsoleVariable<int32> CVarTextureStreamingTailSize(
+	TEXT("actiniaria.TextureStreamingTailSize"),
+	256,
+	TEXT("Largest mip size in pixels sent up front when texture streaming is enabled."));
+
+static TAutoConsoleVariable<int32> CVarTextureMipsCoarseToFine(
+	TEXT("actiniaria.TextureMipsCoarseToFine"),
+	0,
+	TEXT("Send texture mips from the smallest level up instead of starting with mip 0."));
+
+static TAutoConsoleVariable<int32> CVarTexturePacking(
+	TEXT("actiniaria.TexturePacking"),
+	0,
+	TEXT("Pack small textures of the same size and format into texture arrays, the generated shaders sample them by slice."));
+
+static TAutoConsoleVariable<int32> CVarTexturePackingMaxSize(
+	TEXT("actiniaria.TexturePackingMaxSize"),
+	256,
+	TEXT("Largest texture size in pixels that is packed into a texture array when texture packing is enabled."));
+
+static void narrowIndices(const uint32* src, uint16* dst, UINT count)
 {
-	std::wstring_convert<std::codecvt<wchar_t, char, std::mbstate_t>>
-		converter(new std::codecvt<wchar_t, char, std::mbstate_t>("CHS"));
-	return converter.to_bytes(str);
+	for (UINT i = 0; i < count; ++i)
+		dst[i] = (uint16)src[i];
 }
 
-void IPCFrame::createMesh(const std::string& name, FStaticMeshRenderData & renderdata)
+static bool validateNarrowedIndices(const uint32* src, const uint16* dst, UINT count)
 {
+	for (UINT i = 0; i < count; ++i)
+	{
+		if ((uint32)dst[i] != src[i])
+			return false;
+	}
+	return true;
+}
 
-	auto& mesh = renderdata.LODResources[0];
-	UINT numVertices = mesh.GetNumVertices();
-	auto& positions = mesh.VertexBuffers.PositionVertexBuffer;
-	auto& colors = mesh.VertexBuffers.ColorVertexBuffer;
-	auto& vertices = mesh.VertexBuffers.StaticMeshVertexBuffer;
+MeshOptions MeshOptions::fromConsoleVariables()
+{
+	MeshOptions options;
+	options.simd = CVarSIMDVertexPacking.GetValueOnAnyThread() != 0;
+	options.vertexFormat = (VertexFormat)FMath::Clamp(CVarVertexFormat.GetValueOnAnyThread(), (int32)VF_Full, (int32)VF_CompactQuantized);
+	options.maxLODs = CVarMaxLODs.GetValueOnAnyThread();
+	options.narrowIndices = CVarNarrowIndices.GetValueOnAnyThread() != 0;
+	options.validateIndices = CVarValidateIndexNarrowing.GetValueOnAnyThread() != 0;
+	return options;
+}
 
-	UINT vertexstride = (
-		sizeof(FVector) +  // pos
-		sizeof(FVector2D) + //uv
-		sizeof(FVector) +  // normal
-		sizeof(FVector) +  // tangent
-		sizeof(FVector) +// binormal
-		sizeof(FColor) // color
-	); 	
-	std::vector<char> vertexData(vertexstride * numVertices);
-	char* data = vertexData.data();
-	auto move = [](char*& data, const auto& value)
-	{
-		memcpy(data, &value, sizeof(value));
-		data += sizeof(value);
-	};
-	for (UINT i = 0; i < numVertices; ++i)
+static void writeMesh(CacheWriter& writer, const MeshPayload& payload)
+{
+	writer << (uint32)payload.lods.size();
+	for (auto& lod : payload.lods)
 	{
-		FVector pos = positions.VertexPosition(i);
-		FVector2D uv = vertices.GetVertexUV(i, 0);
-		FVector normal = vertices.VertexTangentZ(i);
-		FVector tangent = vertices.VertexTangentX(i);
-		FVector binormal = vertices.VertexTangentY(i);
-		FColor color = (int)colors.GetNumVertices() > i? colors.VertexColor(i):FColor(0xffffffff);
+		writer << lod.screenSize;
+		writer << lod.vertices << lod.numVertices << lod.vertexstride << lod.vertexformat << lod.origin << lod.scale;
+		writer << lod.indices << lod.numIndices << lod.indexstride;
+		writer << (uint32)lod.subs.size();
+		for (auto& s : lod.subs)
+			writer << s;
+	}
+}
 
+static bool readMesh(MeshPayload& payload, const char* data, uint64 size)
+{
+	CacheReader reader(data, size);
+	uint32 numLODs = 0;
+	reader >> numLODs;
+	if (numLODs > MAX_STATIC_MESH_LODS)
+		return false;
+
+	payload.lods.resize(numLODs);
+	for (auto& lod : payload.lods)
+	{
+		reader >> lod.screenSize;
+		reader >> lod.vertices >> lod.numVertices >> lod.vertexstride >> lod.vertexformat >> lod.origin >> lod.scale;
+		reader >> lod.indices >> lod.numIndices >> lod.indexstride;
+		uint32 numSubs = 0;
+		reader >> numSubs;
+		if (!reader.isValid() || numSubs > size / sizeof(SubMesh))
+			return false;
+		lod.subs.resize(numSubs);
+		for (auto& s : lod.subs)
+			reader >> s;
+	}
+	return reader.isValid();
+}
 
-		move(data, pos);
-		move(data, uv);
-		move(data, normal);
-		move(data, tangent);
-		move(data, binormal);
-		move(data, color);
+static FString meshCacheKey(const MeshSnapshot& snapshot, const MeshOptions& options)
+{
+	// the derived data key of the render data is built from the source model hash and build settings
+	if (snapshot.key.IsEmpty())
+		return {};
+
+	CacheKey key(TEXT("mesh"));
+	// simd and validation are in the key so comparing them with the scalar path never returns the other path's payload
+	key << snapshot.key << options.vertexFormat << options.maxLODs << options.narrowIndices << options.simd << options.validateIndices;
+	return key.finalize();
+}
 
+// runs fn on the game thread and waits for it. the export thread copies what it needs from UObjects this way,
+// the editor may change them at any other time
+static void runOnGameThread(TFunction<void()> fn)
+{
+	if (IsInGameThread())
+	{
+		fn();
+		return;
+	}
+	FEvent* done = FPlatformProcess::GetSynchEventFromPool();
+	AsyncTask(ENamedThreads::GameThread, [&fn, done]()
+	{
+		fn();
+		done->Trigger();
+	});
+	done->Wait();
+	FPlatformProcess::ReturnSynchEventToPool(done);
+}
 
-		//memcpy(data, &pos, sizeof(FVector));
-		//memcpy(data + sizeof(FVector), &uv, sizeof(FVector2D));
-		//data += vertexstride;
+std::shared_ptr<MeshSnapshot> IPCFrame::snapshotMesh(const MeshSource& source, const MeshOptions& options)
+{
+	auto snapshot = std::make_shared<MeshSnapshot>();
+	snapshot->name = source.name;
+	auto renderdata = source.mesh ? source.mesh->RenderData.Get() : nullptr;
+	if (renderdata == nullptr)
+		return snapshot;
+
+	snapshot->key = renderdata->DerivedDataKey;
+	snapshot->bounds = renderdata->Bounds;
+	int32 numLODs = renderdata->LODResources.Num();
+	if (options.maxLODs > 0)
+		numLODs = FMath::Min(numLODs, options.maxLODs);
+	for (int32 i = 0; i < numLODs; ++i)
+	{
+		auto& mesh = renderdata->LODResources[i];
+		auto lod = std::make_unique<LODSource>();
+		lod->screenSize = renderdata->ScreenSize[i].Default;
+		lod->positions.Init(mesh.VertexBuffers.PositionVertexBuffer, true);
+		lod->vertices.Init(mesh.VertexBuffers.StaticMeshVertexBuffer, true);
+		lod->colors.Init(mesh.VertexBuffers.ColorVertexBuffer, true);
+
+		auto& indices = mesh.IndexBuffer;
+		lod->is32Bit = indices.Is32Bit();
+		const size_t bytes = (size_t)indices.GetNumIndices() * (lod->is32Bit ? 4 : 2);
+		if (bytes > 0)
+		{
+			auto src = lod->is32Bit ? (const char*)indices.AccessStream32() : (const char*)indices.AccessStream16();
+			lod->indices.assign(src, src + bytes);
+		}
+		for (auto& s : mesh.Sections)
+			lod->subs.push_back({ (UINT)s.MaterialIndex, (UINT)s.FirstIndex, (UINT)s.NumTriangles * 3 });
+		snapshot->lods.push_back(std::move(lod));
 	}
+	return snapshot;
+}
 
-	//mVertices = renderer->createBuffer(cacheData.size(), stride, D3D12_HEAP_TYPE_DEFAULT, cacheData.data(), cacheData.size());
+MeshPayload IPCFrame::buildMesh(const MeshSnapshot& snapshot, const MeshOptions& options, const ExportCache* cache)
+{
+	MeshPayload payload;
+	payload.name = snapshot.name;
 
-	auto& indices = mesh.IndexBuffer;
-	UINT numIndices = indices.GetNumIndices();
-	std::vector<char> indexData;
-	indexData.resize(indices.GetIndexDataSize());
-	UINT indexstride = indices.Is32Bit() ? 4 : 2;
-	data = indexData.data();
-	for (UINT i = 0; i < numIndices; ++i)
+	FString key = cache ? meshCacheKey(snapshot, options) : FString();
+	if (!key.IsEmpty())
 	{
-		auto index = indices.GetIndex(i);
-		memcpy(data, &index, indexstride);
-		data += indexstride;
+		if (cache->load(key, [&payload](const char* data, uint64 size) { return readMesh(payload, data, size); }))
+			return payload;
+		payload.lods.clear();
 	}
 
-	struct SubMesh
+	payload.lods.resize(snapshot.lods.size());
+	for (size_t i = 0; i < snapshot.lods.size(); ++i)
 	{
-		UINT materialIndex;
-		UINT startIndex;
-		UINT numIndices;
-	};
-	std::vector<SubMesh> subs;
+		auto& lod = payload.lods[i];
+		buildLOD(lod, snapshot.name, *snapshot.lods[i], snapshot.bounds, options);
+		lod.screenSize = snapshot.lods[i]->screenSize;
+	}
 
-	for (auto& s : mesh.Sections)
+	if (!key.IsEmpty())
 	{
-		subs.push_back({
-			(UINT)s.MaterialIndex,
-			(UINT)s.FirstIndex,
-			(UINT)s.NumTriangles * 3,
-		});
+		CacheWriter writer;
+		writeMesh(writer, payload);
+		cache->store(key, writer.getData().data(), writer.getData().size());
 	}
+	return payload;
+}
 
-	mIPC << "createMesh" << name ;
-	UINT bytesofvertices = (UINT)vertexData.size();
-	mIPC << bytesofvertices << numVertices << vertexstride;
-	mIPC.send(vertexData.data(), bytesofvertices);
+void IPCFrame::buildLOD(LODPayload& payload, const std::string& name, const LODSource& lod, const FBoxSphereBounds& bounds, const MeshOptions& options)
+{
+	UINT numVertices = lod.positions.GetNumVertices();
+
+	VertexPacker packer(lod.positions, lod.vertices, lod.colors, options.vertexFormat, &bounds);
+	UINT vertexstride = packer.getStride();
+	auto& vertexData = payload.vertices;
+	vertexData.resize(vertexstride * numVertices);
+	packer.pack(vertexData.data(), 0, numVertices, options.simd);
+	payload.numVertices = numVertices;
+	payload.vertexstride = vertexstride;
+	payload.vertexformat = packer.getFormat();
+	payload.origin = packer.getOrigin();
+	payload.scale = packer.getScale();
 
-	UINT bytesofindices = indexData.size();
-	mIPC << bytesofindices << numIndices << indexstride;
-	mIPC.send(indexData.data(), bytesofindices);
+	//mVertices = renderer->createBuffer(cacheData.size(), stride, D3D12_HEAP_TYPE_DEFAULT, cacheData.data(), cacheData.size());
 
+	UINT numIndices = (UINT)(lod.indices.size() / (lod.is32Bit ? 4 : 2));
+	auto& indexData = payload.indices;
+	// every index references a vertex, so 32 bit buffers of small meshes fit in 16 bit
+	bool narrow = lod.is32Bit && numVertices < 65536 && options.narrowIndices;
+	UINT indexstride = lod.is32Bit && !narrow ? 4 : 2;
+	indexData.resize(numIndices * indexstride);
+	if (numIndices > 0)
+	{
+		if (!narrow)
+			memcpy(indexData.data(), lod.indices.data(), lod.indices.size());
+		else
+		{
+			auto src = (const uint32*)lod.indices.data();
+			auto dst = (uint16*)indexData.data();
+			narrowIndices(src, dst, numIndices);
 
-	mIPC << (UINT) subs.size();
+			if (options.validateIndices && !validateNarrowedIndices(src, dst, numIndices))
+			{
+				UE_LOG(LogActiniaria, Error, TEXT("index narrowing of %s does not round trip, sending 32 bit indices"), ANSI_TO_TCHAR(name.c_str()));
+				indexstride = 4;
+				indexData.resize(numIndices * indexstride);
+				memcpy(indexData.data(), src, numIndices * sizeof(uint32));
+			}
+		}
+	}
+	payload.numIndices = numIndices;
+	payload.indexstride = indexstride;
+	payload.subs = lod.subs;
+}
 
-	for (auto& s: subs)
-		mIPC << s;
+void IPCFrame::sendMesh(const MeshPayload& payload)
+{
+	// lods are ordered from the most detailed, each with the screen size (fraction of the screen height covered by the bounds) at which it starts being used
+	mEncoder.begin(OP_CreateMesh);
+	mEncoder.writeName(payload.name) << (UINT)payload.lods.size();
+	sendMessage();
+	for (auto& lod : payload.lods)
+		sendLOD(lod);
 
 
 	//rendercmd.createMesh(name,
@@ -130,100 +373,203 @@ void IPCFrame::createMesh(const std::string& name, FStaticMeshRenderData & rende
 
 }
 
+void IPCFrame::sendLOD(const LODPayload& payload)
+{
+	// every field first, the vertex and index payloads follow the frame
+	UINT bytesofvertices = (UINT)payload.vertices.size();
+	UINT bytesofindices = (UINT)payload.indices.size();
+	mEncoder.begin(OP_MeshLOD);
+	mEncoder << payload.screenSize;
+	mEncoder << bytesofvertices << payload.numVertices << payload.vertexstride;
+	mEncoder << payload.vertexformat << payload.origin << payload.scale;
+	mEncoder << bytesofindices << payload.numIndices << payload.indexstride;
+	mEncoder << (UINT) payload.subs.size();
+	for (auto& s: payload.subs)
+		mEncoder << s;
+	sendMessage();
+
+	sendPayload(payload.vertices.data(), bytesofvertices, SharedArena::PT_Vertices);
+	sendPayload(payload.indices.data(), bytesofindices, SharedArena::PT_Indices);
+}
 
-void IPCFrame::createStaticMesh(AStaticMeshActor * actor)
+void IPCFrame::addMaterial(UMaterialInterface* material)
 {
-	auto component = actor->GetStaticMeshComponent();
-	if (component == nullptr)
+	auto ret = materials.find(material->GetName());
+	if (ret != materials.end())
 		return;
-	auto mesh = component->GetStaticMesh();
-	if (mesh == nullptr)
+
+	materials.insert(material->GetName());
+	mMaterialQueue.push_back(material);
+}
+
+void IPCFrame::addMesh(UStaticMesh* mesh)
+{
+	auto ret = meshs.find(mesh->GetName());
+	if (ret != meshs.end())
 		return;
 
+	meshs.insert(mesh->GetName());
+	mMeshQueue.push_back({ mesh, mNames.get(mesh->GetFName()) });
+}
+
+bool IPCFrame::collectMaterials(UStaticMeshComponent* component, std::vector<std::string>& mats)
+{
 	//auto material = mesh->GetMaterial(0);
 	auto numMaterials = component->GetNumMaterials();
 
-	std::vector<std::string> mats;
 	for (int i = 0; i < numMaterials; ++i)
 	{
 		auto material = component->GetMaterial(i);
 		if (material == nullptr)
 			continue;
 
-		auto ret = materials.find(material->GetName());
-		if (ret != materials.end())
-		{
-		}
-		else
-		{
-			createMaterial(material, textures);
-			materials.insert(material->GetName());
-		}
-
-		mats.push_back(convert(*material->GetName()));
+		addMaterial(material);
+		mats.push_back(mNames.get(material->GetFName()));
 
 	}
 
-	if (mats.size() != numMaterials)
-		return;
-
-
+	return mats.size() == numMaterials;
+}
 
+void IPCFrame::addInstance(const std::string& name, UStaticMesh* mesh, const std::vector<std::string>& mats, const FTransform& transform, const FVector& center, const FVector& extent)
+{
+	addMesh(mesh);
+
+	InstanceData instance;
+	instance.world = transform.ToMatrixWithScale().GetTransposed();
+	instance.nworld = transform.Inverse().ToMatrixWithScale(); // world -> inverse -> transpose -> normal world
+	instance.center = center;
+	instance.extent = extent;
+
+	// instances sharing mesh and material list are drawn as one batch
+	std::string meshname = mNames.get(mesh->GetFName());
+	std::string key = meshname;
+	for (auto& m : mats)
+		key += "|" + m;
+
+	auto ret = mInstanceGroupIndices.find(key);
+	if (!mInstancing || ret == mInstanceGroupIndices.end())
 	{
-		auto ret = meshs.find(mesh->GetName());
-		if (ret != meshs.end())
-		{
-		}
-		else
-		{
-			//dstMesh = StaticMesh::Ptr(new StaticMesh(*mesh->RenderData));
-			createMesh(convert(*mesh->GetName()), *mesh->RenderData);
-			meshs.insert(mesh->GetName());
-		}
+		InstanceGroup group;
+		group.name = name;
+		group.mesh = meshname;
+		group.materials = mats;
+		if (mInstancing)
+			mInstanceGroupIndices[key] = mInstanceGroups.size();
+		mInstanceGroups.push_back(std::move(group));
+		mInstanceGroups.back().instances.push_back(instance);
 	}
+	else
+		mInstanceGroups[ret->second].instances.push_back(instance);
+}
+
+void IPCFrame::collectStaticMesh(AStaticMeshActor * actor)
+{
+	auto component = actor->GetStaticMeshComponent();
+	if (component == nullptr)
+		return;
+	auto mesh = component->GetStaticMesh();
+	if (mesh == nullptr)
+		return;
 
-	auto world = actor->GetTransform().ToMatrixWithScale().GetTransposed();
-	auto nworld = actor->GetTransform().Inverse().ToMatrixWithScale(); // world -> inverse -> transpose -> normal world
+	std::vector<std::string> mats;
+	if (!collectMaterials(component, mats))
+		return;
 
 	FVector center;
 	FVector extent;
-	actor->GetActorBounds(false,center, extent);
+	actor->GetActorBounds(false, center, extent);
+	addInstance(mNames.get(actor->GetFName()), mesh, mats, actor->GetTransform(), center, extent);
+}
+
+void IPCFrame::collectInstancedStaticMesh(UInstancedStaticMeshComponent* component)
+{
+	// also covers UHierarchicalInstancedStaticMeshComponent, skip blueprint templates and components outside a world
+	auto owner = component->GetOwner();
+	if (owner == nullptr || component->IsTemplate() || component->GetWorld() == nullptr)
+		return;
+	auto mesh = component->GetStaticMesh();
+	if (mesh == nullptr)
+		return;
 
-	mIPC << "createModel" << convert(*actor->GetName());
-	mIPC << (UINT)1U << convert(*mesh->GetName()) << world << nworld << center << extent;
-	mIPC << (UINT) mats.size();
-	for (auto& m: mats)
-		mIPC << m;
+	std::vector<std::string> mats;
+	if (!collectMaterials(component, mats))
+		return;
+
+	std::string name = mNames.get(mNames.intern(owner->GetName() + TEXT("_") + component->GetName()));
+	auto bounds = mesh->GetBounds();
+	for (int32 i = 0; i < component->GetInstanceCount(); ++i)
+	{
+		FTransform transform;
+		if (!component->GetInstanceTransform(i, transform, true))
+			continue;
+		auto instancebounds = bounds.TransformBy(transform);
+		addInstance(name + "_" + std::to_string(i), mesh, mats, transform, instancebounds.Origin, instancebounds.BoxExtent);
+	}
+}
 
-	//rendercmd.createModel(convert(*actor->GetName()), { convert(*mesh->GetName()) }, *(Matrix*)&world, *(Matrix*)&nworld, mats);
+void IPCFrame::sendInstanceGroup(const InstanceGroup& group)
+{
+	if (group.instances.size() == 1)
+	{
+		auto& instance = group.instances[0];
+		mEncoder.begin(OP_CreateModel);
+		mEncoder.writeName(group.name) << (UINT)1U;
+		mEncoder.writeName(group.mesh) << instance.world << instance.nworld << instance.center << instance.extent;
+		mEncoder << (UINT) group.materials.size();
+		for (auto& m: group.materials)
+			mEncoder.writeName(m);
+		sendMessage();
+
+		//rendercmd.createModel(convert(*actor->GetName()), { convert(*mesh->GetName()) }, *(Matrix*)&world, *(Matrix*)&nworld, mats);
+		mModelNames.insert(group.name);
+		return;
+	}
 
+	// the batch is named after its first instance, instances are a packed InstanceData array
+	mEncoder.begin(OP_CreateInstances);
+	mEncoder.writeName(group.name).writeName(group.mesh);
+	mEncoder << (UINT) group.materials.size();
+	for (auto& m: group.materials)
+		mEncoder.writeName(m);
+
+	UINT count = (UINT)group.instances.size();
+	UINT stride = (UINT)sizeof(InstanceData);
+	UINT bytes = count * stride;
+	mEncoder << count << stride << bytes;
+	sendMessage();
+	sendPayload(group.instances.data(), bytes, SharedArena::PT_Instances);
 }
 
 
-static DXGI_FORMAT convertFormat(ETextureSourceFormat f)
+// false for source formats the exporter cannot read, textures using them are skipped
+static bool convertFormat(ETextureSourceFormat f, TextureConverter::SourceFormat& format)
 {
 	switch (f)
 	{
-	case TSF_G8:return DXGI_FORMAT_R8_UNORM;
-	case TSF_BGRA8:return DXGI_FORMAT_B8G8R8A8_UNORM;
-	case TSF_RGBA16:return DXGI_FORMAT_R16G16B16A16_UNORM;
-	case TSF_RGBA16F:return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case TSF_G8:format = TextureConverter::SF_G8; return true;
+	case TSF_G16:format = TextureConverter::SF_G16; return true;
+	case TSF_BGRA8:format = TextureConverter::SF_BGRA8; return true;
+	case TSF_RGBA8:format = TextureConverter::SF_RGBA8; return true;
+	case TSF_BGRE8:format = TextureConverter::SF_BGRE8; return true;
+	case TSF_RGBE8:format = TextureConverter::SF_RGBE8; return true;
+	case TSF_RGBA16:format = TextureConverter::SF_RGBA16; return true;
+	case TSF_RGBA16F:format = TextureConverter::SF_RGBA16F; return true;
 	default:
-		assert(0 && "unsupported ue4 texture format");
-		return DXGI_FORMAT_UNKNOWN;
+		return false;
 	}
 }
 
-static UINT sizeof_format(ETextureSourceFormat f)
+static DXGI_FORMAT convertFormat(MipGenerator::PixelFormat f)
 {
 	switch (f)
 	{
-	case TSF_G8:return 1U;
-	case TSF_BGRA8:return 4U;
-	case TSF_RGBA16:return 8U;
-	case TSF_RGBA16F:return 8U;
+	case MipGenerator::PF_R8:return DXGI_FORMAT_R8_UNORM;
+	case MipGenerator::PF_R16:return DXGI_FORMAT_R16_UNORM;
+	case MipGenerator::PF_BGRA8:return DXGI_FORMAT_B8G8R8A8_UNORM;
+	case MipGenerator::PF_RGBA16:return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case MipGenerator::PF_RGBA16F:return DXGI_FORMAT_R16G16B16A16_FLOAT;
 	default:
-		assert(0 && "unsupported ue4 texture format");
 		return DXGI_FORMAT_UNKNOWN;
 	}
 }
@@ -250,63 +596,609 @@ std::string mapTextureType(TEnumAsByte<enum EMaterialSamplerType> type)
 	return "unknown";
 }
 
-void IPCFrame::createMaterial( UMaterialInterface* material, std::set<std::string>& textureMap)
+
+MaterialRecord IPCFrame::captureMaterial(UMaterialInterface* material)
+{
+	MaterialRecord record;
+	record.name = mNames.get(material->GetFName());
+	collectTextures(material, record);
+	translateMaterial(material, record);
+	compileMaterials(&record, 1);
+	return record;
+}
+
+void IPCFrame::collectTextures(UMaterialInterface* material, MaterialRecord& record)
 {
-	std::string name = convert(*material->GetName());
 	auto base = material->GetBaseMaterial();
-	auto toVariable = [](const std::string & str)
-	{
-		std::regex r("[^0-9a-zA-Z_]");
-		return "_" + std::regex_replace(str, r, "_");
-	};
 	//std::map<std::string, Vector4> parameters;
 
-	std::set< std::string> textures;
 	for (auto& expr : base->Expressions)
 	{
 		{
 			const UMaterialExpressionTextureSample* param = Cast<const UMaterialExpressionTextureSample>(expr);
 			if (param)
 			{
-				auto type = param->SamplerType;
 				auto t = param->Texture;
 
-				uint32 width = (uint32)t->GetSurfaceWidth();
-				uint32 height = (uint32)t->GetSurfaceHeight();
-				auto& source = t->Source;
-				auto format = source.GetFormat();
-
-				uint32 BytesPerPixel = source.GetBytesPerPixel();
-
-				std::string texturename = toVariable(convert(*t->GetName()));
-				if (textureMap.find(texturename) == textureMap.end())
+				std::string texturename = mNames.getVariable(mNames.intern(t->GetFName()));
+				TextureConverter::SourceFormat sourceformat;
+				if (!convertFormat(t->Source.GetFormat(), sourceformat))
+				{
+					UE_LOG(LogActiniaria, Warning, TEXT("texture %s of %s has an unsupported source format %d and is not exported"),
+						*t->GetName(), *material->GetName(), (int32)t->Source.GetFormat());
+					continue;
+				}
+				if (textures.find(texturename) == textures.end())
 				{
-					auto src = source.LockMip(0);
-					auto size = sizeof_format(format) * width * height;
-					mIPC << "createTexture" << texturename << width << height << convertFormat(format) << (bool)t->SRGB << size;
-					mIPC.send(src, size);
-					
-					//rendercmd.createTexture(texturename, width, height, convertFormat(format), (bool)t->SRGB,src);
-					source.UnlockMip(0);
+					// the mip itself is read by sendTexture, only the description is taken here
+					TextureRecord texture;
+					texture.name = texturename;
+					texture.texture = t;
+					texture.width = (uint32)t->Source.GetSizeX();
+					texture.height = (uint32)t->Source.GetSizeY();
+					texture.format = t->Source.GetFormat();
+					texture.srgb = (bool)t->SRGB;
+					texture.samplerType = (uint32)param->SamplerType;
+					if (mCache)
+					{
+						CacheKey hash(TEXT("texture"));
+						hash << t->Source.GetIdString() << (uint32)texture.format << texture.width << texture.height;
+						// srgb changes how the mips are filtered, the mip order only changes how they are sent
+						hash << texture.samplerType << texture.srgb << mTextureCompression << mTextureMips;
+						texture.key = hash.finalize();
+					}
+					mTextureIndices[texturename] = mTextureQueue.size();
+					mTextureQueue.push_back(std::move(texture));
 				}
-				textureMap.insert(texturename);
 				textures.insert(texturename);
+				record.textures.insert(texturename);
+			}
+		}
+	}
+}
+
+void IPCFrame::translateMaterial(UMaterialInterface* material, MaterialRecord& record)
+{
+	// packed textures are bound through their array, the shader samples them with the slice index
+	std::map<std::string, TextureSlice> slices;
+	std::set<std::string> bindings;
+	for (auto& name : record.textures)
+	{
+		auto& texture = mTextureQueue[mTextureIndices[name]];
+		if (texture.array < 0 || texture.texture == nullptr)
+		{
+			bindings.insert(name);
+			continue;
+		}
+		auto& array = mTextureArrays[texture.array];
+		slices[mNames.get(texture.texture->GetFName())] = { array.name, texture.slice };
+		bindings.insert(array.name);
+	}
+	record.textures = std::move(bindings);
+
+	// with parameter buffers an instance only brings its parameter block
+	auto base = material->GetBaseMaterial();
+	const ParameterLayout layout = MaterialParser::getParameterLayout(base);
+	if (mParameterBuffers)
+		record.parameters = MaterialParser::packParameters(material, layout);
+
+	// the shader is named after the hash of what it is generated from, materials with identical graphs share it
+	// and its bytecode can be kept across exports
+	CacheKey hash(TEXT("material"));
+	MaterialParser::hashGraph(base, hash);
+	hash << mMaterialOptions;
+	if (mParameterBuffers)
+	{
+		// the cbuffer is laid out from every parameter of the base material, connected or not
+		hash << (uint32)layout.vectors.size() << (uint32)layout.scalars.size();
+		for (auto& name : layout.vectors)
+			hash << name.ToString();
+		for (auto& name : layout.scalars)
+			hash << name.ToString();
+	}
+	else
+	{
+		// baked values as the snapshot resolves them, through parent instances down to the defaults
+		for (float value : MaterialParser::packParameters(material, layout))
+			hash << value;
+	}
+	for (auto& slice : slices)
+		hash << slice.first << slice.second.array << slice.second.slice;
+	const FString key = hash.finalize();
+	record.pixelShader = "ps_" + std::string(TCHAR_TO_ANSI(*key.Right(16)));
+
+	// a shader still waiting to be compiled is filled in by compileMaterials
+	auto generated = mPixelShaders.find(record.pixelShader);
+	if (generated != mPixelShaders.end())
+	{
+		record.shader = generated->second;
+		return;
+	}
+
+	std::vector<char> cached;
+	if (mCache && mCache->load(key, cached))
+		record.shader.assign(cached.begin(), cached.end());
+	if (record.shader.empty())
+	{
+		// only the snapshot needs the UObjects, the hlsl is generated later off the game thread
+		record.graph = std::make_shared<MaterialGraph>(MaterialParser::snapshot(material, std::move(slices)));
+		record.key = key;
+	}
+	mPixelShaders[record.pixelShader] = record.shader;
+}
+
+void IPCFrame::compileMaterials(MaterialRecord* records, size_t count)
+{
+	// every distinct shader is compiled once, compilers keep their own state and only share the handler table
+	std::vector<MaterialRecord*> pending;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (records[i].graph)
+			pending.push_back(&records[i]);
+	}
+	ParallelFor((int32)pending.size(), [&](int32 index)
+	{
+		auto record = pending[index];
+		MaterialCompiler compiler(mMaterialOptions);
+		record->shader = compiler.compile(*record->graph);
+		for (auto& error : compiler.getErrors())
+			UE_LOG(LogActiniaria, Warning, TEXT("material %s: %s"), ANSI_TO_TCHAR(record->name.c_str()), ANSI_TO_TCHAR(error.c_str()));
+	});
+
+	for (auto record : pending)
+	{
+		if (mCache)
+			mCache->store(record->key, record->shader.data(), record->shader.size());
+		mPixelShaders[record->pixelShader] = record->shader;
+		record->graph.reset();
+	}
+	// materials sharing a shader with one compiled above
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (records[i].shader.empty())
+			records[i].shader = mPixelShaders[records[i].pixelShader];
+	}
+}
+
+void IPCFrame::packTextures()
+{
+	// layers of an array need the same size and format, same sampler type and srgb also give them the same block format.
+	// textures already sent or larger than TexturePackingMaxSize keep their own resource
+	std::map<std::tuple<uint32, uint32, uint32, bool, uint32>, std::vector<size_t>> groups;
+	for (size_t i = mTexturesPacked; i < mTextureQueue.size(); ++i)
+	{
+		auto& t = mTextureQueue[i];
+		if (FMath::Max(t.width, t.height) <= mTexturePackingMaxSize)
+			groups[std::make_tuple((uint32)t.format, t.width, t.height, t.srgb, t.samplerType)].push_back(i);
+	}
+	mTexturesPacked = mTextureQueue.size();
+
+	// D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION
+	const size_t maxSlices = 2048;
+	size_t packed = 0;
+	size_t created = 0;
+	for (auto& group : groups)
+	{
+		auto& layers = group.second;
+		for (size_t first = 0; first + 1 < layers.size(); first += maxSlices)
+		{
+			size_t count = FMath::Min(maxSlices, layers.size() - first);
+			if (count < 2)
+				break;
+
+			TextureArray array;
+			array.name = "_textureArray" + std::to_string(mTextureArrays.size());
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto& t = mTextureQueue[layers[first + i]];
+				t.array = (int32)mTextureArrays.size();
+				t.slice = (uint32)i;
+				array.layers.push_back(layers[first + i]);
 			}
+			mTextureArrays.push_back(std::move(array));
+			packed += count;
+			++created;
 		}
 	}
-	MaterialParser parser;
-	mIPC << "createMaterial" << name << "shaders/scene_vs.hlsl" << name + "_ps" << parser(material);
-	mIPC << (UINT) textures.size();
-	for (auto& t: textures)
-		mIPC << t;
+
+	if (packed > 0)
+		UE_LOG(LogActiniaria, Display, TEXT("packed %llu small textures into %llu texture arrays, %llu fewer texture resources"),
+			(uint64)packed, (uint64)created, (uint64)(packed - created));
+}
+
+static FString getBytecodeKey(const std::string& pixelShader)
+{
+	CacheKey hash(TEXT("bytecode"));
+	hash << pixelShader;
+	return hash.finalize();
+}
+
+void IPCFrame::sendMaterial(const MaterialRecord& record, Opcode opcode)
+{
+	auto& name = record.name;
+	// the shader text comes with the first material using the pixel shader, later ones send an empty string and reuse it by name.
+	// bytecode the receiver returned for the shader in an earlier export follows, without it the receiver compiles the text
+	// and, when asked to, sends the bytecode back with OP_ShaderBytecode
+	std::string shader;
+	std::string bytecode;
+	if (mShadersSent.insert(record.pixelShader).second)
+	{
+		shader = record.shader;
+		std::vector<char> cached;
+		if (mCache && mCache->load(getBytecodeKey(record.pixelShader), cached))
+			bytecode.assign(cached.begin(), cached.end());
+	}
+	UINT returnBytecode = !shader.empty() && bytecode.empty() && mCache && mCollectBytecode ? 1 : 0;
+	mBytecodeRequests += returnBytecode;
+	mEncoder.begin(opcode);
+	mEncoder.writeName(name) << "shaders/scene_vs.hlsl";
+	mEncoder.writeName(record.pixelShader) << shader << bytecode << returnBytecode;
+	mEncoder << (UINT) record.textures.size();
+	for (auto& t: record.textures)
+		mEncoder.writeName(t);
+	writeParameters(record.parameters);
+	sendMessage();
 	//rendercmd.createMaterial(name,"shaders/scene_vs.hlsl", name + "_ps", parser(material),textures);
 
 }
 
-void IPCFrame::createSkySphere(const std::string & name, const std::string & meshname, const std::string & mat, const FMatrix& tran)
+void IPCFrame::writeParameters(const std::vector<float>& parameters)
+{
+	// laid out as MaterialParser::getParameterLayout, a size of 0 when parameters are baked into the shader
+	mEncoder.writeBytes(parameters.data(), (UINT)(parameters.size() * sizeof(float)));
+}
+
+static DXGI_FORMAT convertFormat(BlockCompressor::Format f)
+{
+	switch (f)
+	{
+	case BlockCompressor::BC1:return DXGI_FORMAT_BC1_UNORM;
+	case BlockCompressor::BC3:return DXGI_FORMAT_BC3_UNORM;
+	case BlockCompressor::BC4:return DXGI_FORMAT_BC4_UNORM;
+	case BlockCompressor::BC5:return DXGI_FORMAT_BC5_UNORM;
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+static void writeTexture(CacheWriter& writer, const TexturePayload& payload)
+{
+	writer << payload.format << (uint32)payload.mips.size();
+	for (auto& mip : payload.mips)
+		writer << mip.width << mip.height << mip.data;
+}
+
+static bool readTexture(TexturePayload& payload, const char* data, uint64 size)
+{
+	CacheReader reader(data, size);
+	uint32 numMips = 0;
+	reader >> payload.format >> numMips;
+	if (!reader.isValid() || numMips > 32)
+		return false;
+
+	payload.mips.resize(numMips);
+	for (auto& mip : payload.mips)
+		reader >> mip.width >> mip.height >> mip.data;
+	return reader.isValid();
+}
+
+static void compressMip(const BlockCompressor& compressor, const TextureMip& src, TextureMip& dst)
+{
+	const uint32 rows = BlockCompressor::getNumBlocks(src.height);
+	const uint32 rowSize = compressor.getRowSize(src.width);
+	dst.width = src.width;
+	dst.height = src.height;
+	dst.data.resize((size_t)rows * rowSize);
+
+	// about 4k blocks per task
+	const uint32 rowsPerTask = FMath::Max(4096U / BlockCompressor::getNumBlocks(src.width), 1U);
+	const int32 numTasks = (int32)((rows + rowsPerTask - 1) / rowsPerTask);
+	ParallelFor(numTasks, [&](int32 task)
+	{
+		uint32 first = (uint32)task * rowsPerTask;
+		compressor.compress((const uint8*)src.data.data(), src.width, src.height, first, FMath::Min(rowsPerTask, rows - first), (uint8*)dst.data.data() + (size_t)first * rowSize);
+	});
+}
+
+// alpha forces bc3 over bc1, layers of a texture array need the same format
+// copies the source mips buildTexture reads on the game thread, one texture at a time
+static std::vector<TArray<uint8>> copySourceMips(const TextureRecord& record, bool mips)
+{
+	std::vector<TArray<uint8>> copies;
+	runOnGameThread([&]()
+	{
+		if (record.texture == nullptr)
+			return;
+		auto& source = record.texture->Source;
+		const uint32 numMips = mips ? MipGenerator::getNumMips(record.width, record.height) : 1;
+		copies.resize(FMath::Clamp((uint32)source.GetNumMips(), 1U, numMips));
+		for (size_t i = 0; i < copies.size(); ++i)
+			source.GetMipData(copies[i], (int32)i);
+	});
+	return copies;
+}
+
+static TexturePayload buildTexture(const TextureRecord& record, const std::vector<TArray<uint8>>& sourceMips, bool compress, bool mips, bool alpha)
+{
+	if (sourceMips.empty())
+	{
+		UE_LOG(LogActiniaria, Warning, TEXT("texture %s has no source and is sent empty"), ANSI_TO_TCHAR(record.name.c_str()));
+		return {};
+	}
+
+	// the format was checked when the record was captured
+	TextureConverter::SourceFormat sourceformat = TextureConverter::SF_BGRA8;
+	convertFormat(record.format, sourceformat);
+	const TextureConverter converter(sourceformat);
+	const MipGenerator::PixelFormat pixelformat = converter.getTargetFormat();
+	const UINT sourcebpp = TextureConverter::getBytesPerPixel(sourceformat);
+	const UINT bpp = converter.getTargetBytesPerPixel();
+	const uint32 numMips = mips ? MipGenerator::getNumMips(record.width, record.height) : 1;
+
+	std::vector<TextureMip> levels(numMips);
+	for (uint32 i = 0; i < numMips; ++i)
+	{
+		levels[i].width = MipGenerator::getMipSize(record.width, i);
+		levels[i].height = MipGenerator::getMipSize(record.height, i);
+		levels[i].data.resize((size_t)bpp * levels[i].width * levels[i].height);
+	}
+
+	// mips of the source are used as they are, the rest is filtered from the previous level
+	const uint32 numSourceMips = FMath::Min((uint32)sourceMips.size(), numMips);
+	for (uint32 i = 0; i < numSourceMips; ++i)
+	{
+		const size_t numPixels = (size_t)levels[i].width * levels[i].height;
+		if ((size_t)sourceMips[i].Num() < numPixels * sourcebpp)
+		{
+			UE_LOG(LogActiniaria, Warning, TEXT("source mip %u of texture %s is smaller than expected and is sent black"), i, ANSI_TO_TCHAR(record.name.c_str()));
+			continue;
+		}
+		auto src = sourceMips[i].GetData();
+		auto dst = (uint8*)levels[i].data.data();
+		const size_t pixelsPerTask = 65536;
+		ParallelFor((int32)((numPixels + pixelsPerTask - 1) / pixelsPerTask), [&](int32 task)
+		{
+			size_t first = (size_t)task * pixelsPerTask;
+			converter.convert(src + first * sourcebpp, dst + first * bpp, FMath::Min(pixelsPerTask, numPixels - first));
+		});
+	}
+
+	for (uint32 i = numSourceMips; i < levels.size(); ++i)
+	{
+		auto& prev = levels[i - 1];
+		auto& mip = levels[i];
+		MipGenerator generator(pixelformat, record.srgb);
+
+		// each output row reads two source rows, about 32k source pixels per task
+		const uint32 rowsPerTask = FMath::Max(16384U / prev.width, 1U);
+		const int32 numTasks = (int32)((mip.height + rowsPerTask - 1) / rowsPerTask);
+		ParallelFor(numTasks, [&](int32 task)
+		{
+			uint32 first = (uint32)task * rowsPerTask;
+			generator.downsample((const uint8*)prev.data.data(), prev.width, prev.height, first, rowsPerTask, (uint8*)mip.data.data() + (size_t)first * mip.width * bpp);
+		});
+	}
+
+	TexturePayload payload;
+	payload.format = convertFormat(pixelformat);
+
+	// bc formats need whole blocks on the top mip, smaller levels are padded by the encoder
+	if (!compress || pixelformat != MipGenerator::PF_BGRA8 || record.width % 4 != 0 || record.height % 4 != 0)
+	{
+		payload.mips = std::move(levels);
+		return payload;
+	}
+
+	// bc5 drops blue, the generated shader rebuilds it for normal samplers
+	BlockCompressor compressor(
+		record.samplerType == SAMPLERTYPE_Normal ? BlockCompressor::BC5 :
+		alpha || BlockCompressor::hasAlpha((const uint8*)levels[0].data.data(), (size_t)record.width * record.height) ? BlockCompressor::BC3 : BlockCompressor::BC1);
+
+	payload.format = convertFormat(compressor.getFormat());
+	payload.mips.resize(levels.size());
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		compressMip(compressor, levels[i], payload.mips[i]);
+		levels[i].data = std::vector<char>();
+	}
+	return payload;
+}
+
+std::vector<char> IPCFrame::encodeTopMip(UTexture2D* texture)
+{
+	TextureRecord record;
+	record.name = TCHAR_TO_UTF8(*texture->GetName());
+	record.texture = texture;
+	record.format = texture->Source.GetFormat();
+	record.width = (uint32)texture->Source.GetSizeX();
+	record.height = (uint32)texture->Source.GetSizeY();
+	record.srgb = (bool)texture->SRGB;
+	record.samplerType = SAMPLERTYPE_Color;
+	TextureConverter::SourceFormat sourceformat;
+	if (record.width == 0 || record.height == 0 || !convertFormat(record.format, sourceformat))
+		return {};
+	auto payload = buildTexture(record, copySourceMips(record, false), CVarTextureCompression.GetValueOnAnyThread() != 0, false, false);
+	return payload.mips.empty() ? std::vector<char>() : std::move(payload.mips[0].data);
+}
+
+TexturePayload IPCFrame::loadTexture(const TextureRecord& record, bool alpha) const
+{
+	// LockMip decompresses the source, mip generation and block compression are slower still, a cached entry skips all of it
+	TexturePayload payload;
+	const FString key = alpha ? record.key + TEXT("_alpha") : record.key;
+	if (mCache && mCache->load(key, [&payload](const char* data, uint64 size) { return readTexture(payload, data, size); }))
+		return payload;
+
+	// the copy is dropped as soon as the payload is encoded, streamed textures copy their source again on request
+	payload = buildTexture(record, copySourceMips(record, mTextureMips), mTextureCompression, mTextureMips, alpha);
+	if (mCache && !payload.mips.empty())
+	{
+		CacheWriter writer;
+		writeTexture(writer, payload);
+		mCache->store(key, writer.getData().data(), writer.getData().size());
+	}
+	return payload;
+}
+
+void IPCFrame::sendMip(const TexturePayload& payload, UINT level)
+{
+	auto& mip = payload.mips[level];
+	UINT size = (UINT)mip.data.size();
+	mEncoder.begin(OP_TextureMip);
+	mEncoder << level << size;
+	sendMessage();
+	sendPayload(mip.data.data(), size, SharedArena::PT_Texture);
+}
+
+void IPCFrame::sendTexture(size_t index)
+{
+	auto& record = mTextureQueue[index];
+	// the texture is kept alive by AddReferencedObjects, it is only gone if it was force deleted during the export.
+	// packed textures are sent with their array
+	if (record.texture == nullptr || record.array >= 0)
+		return;
+
+	TexturePayload payload = loadTexture(record);
+	UINT numMips = (UINT)payload.mips.size();
+
+	// with streaming only the tail up to TextureStreamingTailSize is sent, the receiver asks for the rest with OP_RequestTextureMips
+	UINT firstMip = 0;
+	if (mTextureStreaming)
+	{
+		while (firstMip + 1 < numMips && FMath::Max(payload.mips[firstMip].width, payload.mips[firstMip].height) > mStreamingTailSize)
+			++firstMip;
+		if (firstMip > 0)
+			mStreamedTextures[record.name] = { index, firstMip };
+	}
+
+	// mips [firstMip, numMips) follow with their level, coarse to fine lets the receiver show a low resolution version before the large levels arrive
+	mEncoder.begin(OP_CreateTexture);
+	mEncoder.writeName(record.name) << record.width << record.height << payload.format << (uint8)record.srgb << numMips << firstMip;
+	sendMessage();
+	for (UINT i = firstMip; i < numMips; ++i)
+		sendMip(payload, mMipsCoarseToFine ? numMips - 1 - (i - firstMip) : i);
+	//rendercmd.createTexture(texturename, width, height, convertFormat(format), (bool)t->SRGB,src);
+}
+
+void IPCFrame::sendTextureArray(const TextureArray& array)
+{
+	std::vector<TexturePayload> layers(array.layers.size());
+	for (size_t i = 0; i < layers.size(); ++i)
+	{
+		auto& record = mTextureQueue[array.layers[i]];
+		if (record.texture)
+			layers[i] = loadTexture(record);
+	}
+
+	// bc1 and bc3 cannot share a resource, opaque layers are encoded again as bc3 when another layer has alpha
+	bool alpha = std::any_of(layers.begin(), layers.end(), [](const TexturePayload& p) { return p.format == DXGI_FORMAT_BC3_UNORM; });
+	for (size_t i = 0; i < layers.size(); ++i)
+	{
+		if (alpha && layers[i].format == DXGI_FORMAT_BC1_UNORM)
+			layers[i] = loadTexture(mTextureQueue[array.layers[i]], true);
+	}
+
+	// a force deleted layer is sent black
+	auto reference = std::find_if(layers.begin(), layers.end(), [](const TexturePayload& p) { return !p.mips.empty(); });
+	if (reference == layers.end())
+		return;
+	for (auto& layer : layers)
+	{
+		if (!layer.mips.empty())
+			continue;
+		layer.format = reference->format;
+		layer.mips = reference->mips;
+		for (auto& mip : layer.mips)
+			std::fill(mip.data.begin(), mip.data.end(), 0);
+	}
+
+	// packed textures are at most TexturePackingMaxSize, they are not streamed and every layer is sent whole
+	auto& first = mTextureQueue[array.layers[0]];
+	UINT numMips = (UINT)reference->mips.size();
+	mEncoder.begin(OP_CreateTextureArray);
+	mEncoder.writeName(array.name) << first.width << first.height << reference->format << (uint8)first.srgb << (UINT)layers.size() << numMips;
+	sendMessage();
+	for (auto& layer : layers)
+	{
+		for (UINT i = 0; i < numMips; ++i)
+			sendMip(layer, mMipsCoarseToFine ? numMips - 1 - i : i);
+	}
+}
+
+bool IPCFrame::serveRequests(ExportProgress& progress)
+{
+	if (mStreamedTextures.empty() && mBytecodeRequests == 0)
+		return true;
+
+	// the receiver asks for more detailed mips as textures become visible, returns the bytecode of the shaders it compiled
+	// and sends OP_EndStreaming when it is done with both. a cancel is seen with the next message.
+	// its frames refer to the names this side defined
+	bool ended = false;
+	ProtocolDispatcher dispatcher;
+	dispatcher.getDecoder().shareNames(&mEncoder.getNames());
+	dispatcher.set(OP_EndStreaming, [&ended](ProtocolDecoder&) { ended = true; });
+	dispatcher.set(OP_ShaderBytecode, [this](ProtocolDecoder& decoder)
+	{
+		std::string pixelShader;
+		std::vector<char> bytecode;
+		decoder.readName(pixelShader).readBytes(bytecode);
+		if (decoder.isComplete() && mCache && !bytecode.empty())
+			mCache->store(getBytecodeKey(pixelShader), bytecode.data(), bytecode.size());
+	});
+	dispatcher.set(OP_RequestTextureMips, [this, &progress](ProtocolDecoder& decoder)
+	{
+		std::string name;
+		UINT level = 0;
+		decoder.readName(name) >> level;
+		if (decoder.isComplete() && sendTextureMips(name, level))
+			++progress.served;
+	});
+
+	progress.streaming = true;
+	while (!progress.cancelled)
+	{
+		// the replies to earlier requests may still wait in the batch
+		mWriter->flush();
+		std::string frame;
+		mIPC >> frame;
+		if (!dispatcher.dispatch(frame.data(), frame.size()))
+		{
+			UE_LOG(LogActiniaria, Warning, TEXT("unexpected message from the render station, opcode %d"), (int32)dispatcher.getDecoder().getOpcode());
+			return false;
+		}
+		if (ended)
+			return true;
+	}
+	return false;
+}
+
+bool IPCFrame::sendTextureMips(const std::string& name, UINT level)
 {
-	mIPC << "createSky" << name << meshname << mat << tran;
-	//rendercmd.createSky(name, meshname, mat, tran);
+	// levels the receiver already has are not sent again
+	auto ret = mStreamedTextures.find(name);
+	if (ret == mStreamedTextures.end() || level >= ret->second.firstMip)
+		return false;
+	auto& record = mTextureQueue[ret->second.record];
+	if (record.texture == nullptr)
+		return false;
+
+	// from the level below the resident ones up to the requested level
+	TexturePayload payload = loadTexture(record);
+	UINT firstMip = FMath::Min(ret->second.firstMip, (UINT)payload.mips.size());
+	// a rebuilt or reloaded payload may have fewer levels than were announced, the count below must not wrap
+	if (level >= firstMip)
+	{
+		UE_LOG(LogActiniaria, Warning, TEXT("texture %s has %u mips now, mip %u cannot be streamed"), ANSI_TO_TCHAR(name.c_str()), (UINT)payload.mips.size(), level);
+		return false;
+	}
+	mEncoder.begin(OP_TextureMips);
+	mEncoder.writeName(name) << level << firstMip - level;
+	sendMessage();
+	for (UINT i = firstMip; i-- > level; )
+		sendMip(payload, i);
+
+	ret->second.firstMip = level;
+	return true;
 }
 
 IPCFrame::IPCFrame()
@@ -321,27 +1213,270 @@ IPCFrame::IPCFrame()
 	//	std::cout << "console started." << std::endl;
 	//}
 	//FString path = GetPluginPath() + "/Source/actiniaria/Private/engine/";
+	mInstancing = CVarInstancedExport.GetValueOnAnyThread() != 0;
+	mMaterialOptions = MaterialParser::getOptions();
+	mParameterBuffers = (mMaterialOptions & MaterialCompiler::MO_ParameterBuffers) != 0;
+	mTextureCompression = CVarTextureCompression.GetValueOnAnyThread() != 0;
+	mTextureMips = CVarTextureMips.GetValueOnAnyThread() != 0;
+	mMipsCoarseToFine = CVarTextureMipsCoarseToFine.GetValueOnAnyThread() != 0;
+	mTextureStreaming = mTextureMips && CVarTextureStreaming.GetValueOnAnyThread() != 0;
+	mStreamingTailSize = (uint32)FMath::Max(CVarTextureStreamingTailSize.GetValueOnAnyThread(), 1);
+	mTexturePacking = CVarTexturePacking.GetValueOnAnyThread() != 0;
+	mTexturePackingMaxSize = (uint32)FMath::Max(CVarTexturePackingMaxSize.GetValueOnAnyThread(), 1);
+	if (CVarExportCache.GetValueOnAnyThread() != 0)
+		mCache = std::make_unique<ExportCache>(ExportCache::getDefaultDirectory());
+
+	size_t batchSize = (size_t)FMath::Max(CVarIPCBatchSizeKB.GetValueOnAnyThread(), 0) << 10;
+	auto latency = std::chrono::milliseconds(FMath::Max(CVarIPCBatchLatencyMs.GetValueOnAnyThread(), 0));
+	mWriter = std::make_unique<BatchWriter>([this](const void* data, size_t size) { mIPC.send(data, (UINT)size); }, batchSize, batchSize, latency);
+}
+
+bool IPCFrame::connect()
+{
 	mIPC.listen("renderstation");
+
+	// everything after the handshake is binary, a receiver speaking another version could not even parse the error
+	const int32 compression = CVarIPCCompression.GetValueOnAnyThread();
+	UINT codecs = 1U << PC_None;
+	if (compression & 1)
+		codecs |= 1U << PC_LZ4;
+	if (compression & 2)
+		codecs |= 1U << PC_Zlib;
+	mIPC << "protocol" << PROTOCOL_VERSION << (codecs & PayloadCompressor::getSupportedCodecs());
+	UINT version = 0;
+	mIPC >> version;
+	if (version != PROTOCOL_VERSION)
+	{
+		UE_LOG(LogActiniaria, Error, TEXT("the render station speaks protocol version %u, the exporter %u"), version, PROTOCOL_VERSION);
+		return false;
+	}
+	UINT codec = PC_None;
+	mIPC >> codec;
+	if (codec >= PC_Count || (codecs & (1U << codec)) == 0)
+	{
+		UE_LOG(LogActiniaria, Error, TEXT("the render station picked payload codec %u which was not offered"), codec);
+		return false;
+	}
+	if (codec != PC_None)
+	{
+		uint32 chunkSize = (uint32)FMath::Max(CVarIPCCompressionChunkKB.GetValueOnAnyThread(), 1) << 10;
+		uint32 minSize = (uint32)FMath::Max(CVarIPCCompressionMinKB.GetValueOnAnyThread(), 0) << 10;
+		mCompressor = std::make_unique<PayloadCompressor>((PayloadCodec)codec, chunkSize, minSize);
+	}
+
+	if (CVarSharedMemoryTransport.GetValueOnAnyThread() != 0)
+	{
+		// announce the arena before anything else, every payload after this is sent as a SharedArena::Descriptor
+		mArena = std::make_unique<SharedArena>();
+		std::string arenaname = "renderstation_payloads_" + std::to_string(FPlatformProcess::GetCurrentProcessId());
+		size_t capacity = (size_t)FMath::Max(CVarSharedMemorySizeMB.GetValueOnAnyThread(), 1) << 20;
+		if (mArena->create(arenaname, capacity))
+		{
+			mEncoder.begin(OP_Transport);
+			mEncoder << arenaname << (uint64)mArena->capacity();
+			sendMessage();
+		}
+		else
+			mArena.reset();
+	}
+	return true;
+}
+
+void IPCFrame::sendMessage()
+{
+	mEncoder.end();
+	auto& frames = mEncoder.getFrames();
+	mWriter->write(frames.data(), frames.size());
+	mEncoder.clearFrames();
+}
+
+void IPCFrame::sendPayload(const void* data, UINT size, UINT type)
+{
+	if (mCompressor)
+	{
+		mCompressor->compress(data, size, mCompressed);
+		data = mCompressed.data();
+		size = (UINT)mCompressed.size();
+	}
+
+	if (!mArena)
+	{
+		mWriter->write(data, size);
+		return;
+	}
+
+	// the receiver frees space only after reading the descriptors still waiting in the batch, so they are flushed
+	// before waiting. it then has 10s to release space before the payload falls back to the pipe
+	SharedArena::Descriptor desc;
+	char* dst = mArena->acquire(size, type, desc, 0);
+	if (dst == nullptr)
+	{
+		mWriter->flush();
+		dst = mArena->acquire(size, type, desc, 10000);
+	}
+	if (dst == nullptr)
+	{
+		desc = { SharedArena::inlinePosition, size, type };
+		mWriter->write(&desc, sizeof(desc));
+		mWriter->write(data, size);
+		return;
+	}
+
+	memcpy(dst, data, size);
+	// the receiver reads the arena only after the descriptor arrived, the memcpy is done before it leaves the batch
+	mWriter->write(&desc, sizeof(desc));
 }
 
 IPCFrame::~IPCFrame()
 {
 }
 
+void IPCFrame::AddReferencedObjects(FReferenceCollector& collector)
+{
+	// the export thread reads render data and texture sources of the snapshot, keep them loaded until it is done
+	for (auto& m : mMeshQueue)
+		collector.AddReferencedObject(m.mesh);
+	for (auto& t : mTextureQueue)
+		collector.AddReferencedObject(t.texture);
+}
+
 void IPCFrame::iterateLights()
 {
 	for (TObjectIterator<ADirectionalLight> iter; iter; ++iter)
 	{
 		auto light = *iter;
-		auto dir = light->GetTransform().ToMatrixNoScale().TransformFVector4(FVector4{1,0,0,0});
-		auto brightness = light->GetBrightness();
-		auto color = light->GetLightColor() * brightness;
+		mLights.push_back(captureLight(light));
+	}
+
+}
+
+LightRecord IPCFrame::captureLight(ADirectionalLight* light)
+{
+	auto dir = light->GetTransform().ToMatrixNoScale().TransformFVector4(FVector4{1,0,0,0});
+	auto brightness = light->GetBrightness();
+
+	LightRecord record;
+	record.name = mNames.get(light->GetFName());
+	record.color = light->GetLightColor() * brightness;
+	record.dir = FVector(dir);
+	return record;
+}
+
+void IPCFrame::sendLight(const LightRecord& light, Opcode opcode)
+{
+	mEncoder.begin(opcode);
+	mEncoder.writeName(light.name) << UINT(0) << light.color << light.dir;
+	sendMessage();
+	mLightNames.insert(light.name);
+	//rendercmd.createLight(convert(*light->GetName()),0,*(Color*)&color, *(Vector3*)&dir);
+}
+
+void IPCFrame::sendPending()
+{
+	translateMaterials();
+	ExportProgress progress;
+	sendQueued(progress);
+}
+
+void IPCFrame::addActor(AActor* actor)
+{
+	std::string name = mNames.get(actor->GetFName());
+	if (mModelNames.find(name) != mModelNames.end() || mLightNames.find(name) != mLightNames.end())
+		return;
+
+	if (auto light = Cast<ADirectionalLight>(actor))
+	{
+		sendLight(captureLight(light), OP_CreateLight);
+		return;
+	}
+
+	auto smactor = Cast<AStaticMeshActor>(actor);
+	if (smactor == nullptr)
+		return;
+
+	collectStaticMesh(smactor);
+	sendPending();
+}
+
+void IPCFrame::updateActor(AActor* actor)
+{
+	std::string name = mNames.get(actor->GetFName());
+	if (auto light = Cast<ADirectionalLight>(actor))
+	{
+		sendLight(captureLight(light), mLightNames.find(name) != mLightNames.end() ? OP_UpdateLight : OP_CreateLight);
+		return;
+	}
+
+	if (mModelNames.find(name) == mModelNames.end())
+	{
+		addActor(actor);
+		return;
+	}
+
+	auto& transform = actor->GetTransform();
+	FVector center;
+	FVector extent;
+	actor->GetActorBounds(false, center, extent);
+	mEncoder.begin(OP_UpdateTransform);
+	mEncoder.writeName(name) << transform.ToMatrixWithScale().GetTransposed() << transform.Inverse().ToMatrixWithScale() << center << extent;
+	sendMessage();
+}
+
+void IPCFrame::destroyActor(const FString& actorname)
+{
+	std::string name = mNames.get(mNames.intern(actorname));
+	Opcode opcode;
+	if (mModelNames.erase(name) > 0)
+		opcode = OP_DestroyModel;
+	else if (mLightNames.erase(name) > 0)
+		opcode = OP_DestroyLight;
+	else
+		return;
+	mEncoder.begin(opcode);
+	mEncoder.writeName(name);
+	sendMessage();
+}
+
+void IPCFrame::updateMaterial(UMaterialInterface* changed)
+{
+	// a changed base material invalidates the shaders of all its exported instances.
+	// with parameter buffers an edited instance keeps its shader, it and the instances below it only get new parameters
+	std::vector<UMaterialInterface*> affected;
+	for (size_t i = 0; i < mMaterialsTranslated; ++i)
+	{
+		auto material = mMaterialQueue[i].Get();
+		if (material && (material == changed || material->IsDependent(changed)))
+			affected.push_back(material);
+	}
 
-		mIPC << "createLight" << convert(*light->GetName()) << UINT(0) << color << FVector(dir);
-		//rendercmd.createLight(convert(*light->GetName()),0,*(Color*)&color, *(Vector3*)&dir);
+	if (mParameterBuffers && Cast<UMaterialInstance>(changed))
+	{
+		for (auto material : affected)
+		{
+			mEncoder.begin(OP_UpdateMaterialParameters);
+			mEncoder.writeName(mNames.get(material->GetFName()));
+			writeParameters(MaterialParser::packParameters(material, MaterialParser::getParameterLayout(material->GetBaseMaterial())));
+			sendMessage();
+		}
+		return;
+	}
 
+	// an edit that changes the generated shader also changes its name, the receiver then gets the new text
+	ExportProgress progress;
+	for (auto material : affected)
+	{
+		auto record = captureMaterial(material);
+		sendTextures(progress);
+		sendMaterial(record, OP_UpdateMaterial);
 	}
+}
 
+void IPCFrame::commit()
+{
+	mEncoder.begin(OP_Commit);
+	sendMessage();
+	// the deltas of a tick are shown without waiting for the next tick
+	mWriter->flush();
 }
 
 void IPCFrame::iterateCapture()
@@ -356,99 +1491,315 @@ void IPCFrame::iterateCapture()
 		if (data == nullptr)
 			continue;
 		auto transfrom = comp->GetComponentTransform();
-		auto mat = transfrom.ToMatrixWithScale().GetTransposed();
-
 
-		mIPC
-			<< "createReflectionProbe" 
-			<< convert(*actor->GetName()) 
-			<< mat 
-			<< comp->GetInfluenceBoundingRadius() 
-			<< data->Brightness 
-			<< (UINT)data->CubemapSize;
-		UINT size = data->FullHDRCapturedData.Num();
-		mIPC << size;
-		mIPC.send(data->FullHDRCapturedData.GetData(), size);
-		//rendercmd.createReflectionProbe(
-		//	convert(*actor->GetName()),
-		//	*(Matrix*)&mat,
-		//	comp->GetInfluenceBoundingRadius(),
-		//	data->Brightness,data->CubemapSize, 
-		//	data->FullHDRCapturedData.GetData(), 
-		//	data->FullHDRCapturedData.Num()
-		//);
+		// the build data may be replaced by a lighting build while the export runs, take a copy
+		CaptureRecord capture;
+		capture.name = mNames.get(actor->GetFName());
+		capture.world = transfrom.ToMatrixWithScale().GetTransposed();
+		capture.radius = comp->GetInfluenceBoundingRadius();
+		capture.brightness = data->Brightness;
+		capture.cubemapSize = (UINT)data->CubemapSize;
+		capture.data = data->FullHDRCapturedData;
+		mCaptures.push_back(std::move(capture));
 	}
 }
 
-void IPCFrame::init()
+void IPCFrame::sendCapture(const CaptureRecord& capture)
+{
+	UINT size = capture.data.Num();
+	mEncoder.begin(OP_CreateReflectionProbe);
+	mEncoder.writeName(capture.name);
+	mEncoder
+		<< capture.world 
+		<< capture.radius 
+		<< capture.brightness 
+		<< capture.cubemapSize
+		<< size;
+	sendMessage();
+	sendPayload(capture.data.GetData(), size, SharedArena::PT_ReflectionCapture);
+	//rendercmd.createReflectionProbe(
+	//	convert(*actor->GetName()),
+	//	*(Matrix*)&mat,
+	//	comp->GetInfluenceBoundingRadius(),
+	//	data->Brightness,data->CubemapSize, 
+	//	data->FullHDRCapturedData.GetData(), 
+	//	data->FullHDRCapturedData.Num()
+	//);
+}
+
+void IPCFrame::capture()
 {
+	check(IsInGameThread());
+	captureCamera();
 	iterateObjects();
+	translateMaterials();
 	iterateLights();
 	iterateCapture();
-	mIPC << "done";
 }
 
-void IPCFrame::iterateObjects()
+bool IPCFrame::step(ExportProgress& progress)
+{
+	++progress.completed;
+	return !progress.cancelled;
+}
+
+bool IPCFrame::send(ExportProgress* progress)
+{
+	ExportProgress local;
+	if (progress == nullptr)
+		progress = &local;
+
+	progress->total = (int32)(
+		mTextureQueue.size() - mTexturesSent +
+		mTextureArrays.size() - mTextureArraysSent +
+		mMaterialRecords.size() - mMaterialsSent +
+		mMeshQueue.size() - mMeshesSent +
+		mInstanceGroups.size() - mInstanceGroupsSent +
+		mSkies.size() + mLights.size() + mCaptures.size());
+
+	// blocks until the render station connects. ExportJob interrupts the wait on cancel, or leaves this thread behind
+	if (progress->cancelled || !connect())
+		return false;
+	progress->connected = true;
+
+	auto cancel = [this]()
+	{
+		mEncoder.begin(OP_Cancel);
+		sendMessage();
+		mWriter->flush();
+		return false;
+	};
+
+	if (progress->cancelled)
+		return cancel();
+
+	mEncoder.begin(OP_CreateCamera);
+	mEncoder.writeName("main");
+	mEncoder
+		<< mCamera.pos
+		<< mCamera.dir
+		<< mCamera.view 
+		<< mCamera.proj 
+		<< 0.0f 
+		<< 0.0f 
+		<< mCamera.width 
+		<< mCamera.height 
+		<< 0.0f
+		<< 1.0f;
+	sendMessage();
+
+	//rendercmd.createCamera("main",{pos.X, pos.Y, pos.Z}, {dir.X, dir.Y, dir.Z}, *(Matrix*)&view, *(Matrix*)&proj, { 0,0, width , height, 0.0f, 1.0f });
+
+	if (!sendQueued(*progress))
+		return cancel();
+
+	for (auto& s : mSkies)
+	{
+		mEncoder.begin(OP_CreateSky);
+		mEncoder.writeName(s.name).writeName(s.mesh).writeName(s.material) << s.world << s.center << s.extent;
+		sendMessage();
+		if (!step(*progress))
+			return cancel();
+	}
+
+	for (auto& l : mLights)
+	{
+		sendLight(l, OP_CreateLight);
+		if (!step(*progress))
+			return cancel();
+	}
+
+	for (auto& c : mCaptures)
+	{
+		sendCapture(c);
+		if (!step(*progress))
+			return cancel();
+	}
+	// reflection data is only needed once
+	mCaptures.clear();
+
+	mEncoder.begin(OP_Done);
+	sendMessage();
+	mWriter->flush();
+	return true;
+}
+
+void IPCFrame::translateMaterials()
+{
+	// textures of all new materials are collected first so the small ones can be packed before any shader is generated
+	std::vector<UMaterialInterface*> translated;
+	const size_t first = mMaterialRecords.size();
+	for (; mMaterialsTranslated < mMaterialQueue.size(); ++mMaterialsTranslated)
+	{
+		if (auto material = mMaterialQueue[mMaterialsTranslated].Get())
+		{
+			MaterialRecord record;
+			record.name = mNames.get(material->GetFName());
+			collectTextures(material, record);
+			mMaterialRecords.push_back(std::move(record));
+			translated.push_back(material);
+		}
+	}
+
+	if (mTexturePacking)
+		packTextures();
+
+	size_t textureBindings = 0;
+	size_t bindings = 0;
+	for (size_t i = 0; i < translated.size(); ++i)
+	{
+		auto& record = mMaterialRecords[first + i];
+		textureBindings += record.textures.size();
+		translateMaterial(translated[i], record);
+		bindings += record.textures.size();
+	}
+	if (bindings < textureBindings)
+		UE_LOG(LogActiniaria, Display, TEXT("texture packing saves %llu of %llu texture bindings in %llu materials"),
+			(uint64)(textureBindings - bindings), (uint64)textureBindings, (uint64)translated.size());
+}
+
+bool IPCFrame::sendTextures(ExportProgress& progress)
+{
+	for (; mTexturesSent < mTextureQueue.size(); )
+	{
+		sendTexture(mTexturesSent++);
+		if (!step(progress))
+			return false;
+	}
+	for (; mTextureArraysSent < mTextureArrays.size(); )
+	{
+		sendTextureArray(mTextureArrays[mTextureArraysSent++]);
+		if (!step(progress))
+			return false;
+	}
+	return true;
+}
+
+bool IPCFrame::sendMaterials(ExportProgress& progress)
+{
+	for (; mMaterialsSent < mMaterialRecords.size(); )
+	{
+		sendMaterial(mMaterialRecords[mMaterialsSent++]);
+		if (!step(progress))
+			return false;
+	}
+	return true;
+}
+
+bool IPCFrame::sendQueued(ExportProgress& progress)
 {
+	// render data is copied on the game thread a window of meshes at a time and packed on the thread pool while
+	// textures and materials are sent, at most about two windows of copies and payloads are in memory
+	const MeshOptions options = MeshOptions::fromConsoleVariables();
+	const size_t first = mMeshesSent;
+	const size_t count = mMeshQueue.size() - first;
+	const size_t window = (size_t)FMath::Max(FPlatformMisc::NumberOfWorkerThreadsToSpawn() * 2, 2);
+	std::vector<TFuture<MeshPayload>> builds(count);
+	std::vector<std::shared_ptr<MeshSnapshot>> snapshots(count);
+	size_t snapshotted = 0;
+	auto launch = [&](size_t index)
+	{
+		if (index >= count)
+			return;
+		if (index >= snapshotted)
+		{
+			const size_t end = FMath::Min(index + window, count);
+			runOnGameThread([&]()
+			{
+				for (size_t i = snapshotted; i < end; ++i)
+					snapshots[i] = snapshotMesh(mMeshQueue[first + i], options);
+			});
+			snapshotted = end;
+		}
+		builds[index] = Async(EAsyncExecution::ThreadPool, [snapshot = snapshots[index], options, cache = mCache.get()]()
+		{
+			return buildMesh(*snapshot, options, cache);
+		});
+		snapshots[index].reset();
+	};
+	for (size_t i = 0; i < window; ++i)
+		launch(i);
+
+	// shaders are generated here rather than in capture, in parallel while the mesh payloads build
+	compileMaterials(mMaterialRecords.data() + mMaterialsSent, mMaterialRecords.size() - mMaterialsSent);
+	bool ok = sendTextures(progress) && sendMaterials(progress);
+
+	// this thread is the only writer of mIPC, payloads are streamed in collection order
+	for (size_t i = 0; ok && i < count; ++i)
+	{
+		sendMesh(builds[i].Get());
+		builds[i] = TFuture<MeshPayload>();
+		launch(i + window);
+		++mMeshesSent;
+		ok = step(progress);
+	}
+
+	// builds still in flight after a cancel use the cache, wait for them
+	for (auto& b : builds)
+	{
+		if (b.IsValid())
+			b.Wait();
+	}
+	if (!ok)
+		return false;
 
+	for (; mInstanceGroupsSent < mInstanceGroups.size(); )
 	{
-		auto camIter = TObjectIterator<ACameraActor>();
-		assert(!!camIter && "need camera");
-		auto camact = *camIter;
-		auto camcom = camact->GetCameraComponent();
-		FMinimalViewInfo info;
-		camcom->GetCameraView(0, info);
-
-		FMatrix proj;
-		float FarZ = GNearClippingPlane;
-		float NearZ = GNearClippingPlane;
-		float halfFov = info.FOV * 0.5f * PI / 180.0f;
-		float height = 600;
-		float width = info.AspectRatio * height;
-
-		proj = FPerspectiveMatrix(halfFov, width, height, NearZ, FarZ).GetTransposed();
-
-
-		auto rot = camact->GetTransform().GetRotation().Rotator();
-		FMatrix ViewPlanesMatrix = FMatrix(
-			FPlane(0, 0, 1, 0),
-			FPlane(1, 0, 0, 0),
-			FPlane(0, 1, 0, 0),
-			FPlane(0, 0, 0, 1));
-		auto rotmat = FInverseRotationMatrix(rot) * ViewPlanesMatrix;
-		auto dir = camact->GetTransform().ToMatrixNoScale().TransformVector({1,0,0});
-		auto pos = camact->GetTransform().GetLocation();
-		auto view = FTranslationMatrix(-camact->GetTransform().GetLocation()) * rotmat;
-		view = view.GetTransposed();
-
-		mIPC 
-			<< "createCamera" 
-			<< "main" 
-			<< FVector(pos)
-			<< FVector(dir)
-			<< view 
-			<< proj 
-			<< 0.0f 
-			<< 0.0f 
-			<< width 
-			<< height 
-			<< 0.0f
-			<< 1.0f;
-
-		//rendercmd.createCamera("main",{pos.X, pos.Y, pos.Z}, {dir.X, dir.Y, dir.Z}, *(Matrix*)&view, *(Matrix*)&proj, { 0,0, width , height, 0.0f, 1.0f });
-
-	}
-
-	std::set<FString> meshs;
-	std::set<FString> materials;
-	std::set<std::string> textures;
+		sendInstanceGroup(mInstanceGroups[mInstanceGroupsSent++]);
+		if (!step(progress))
+			return false;
+	}
+	return true;
+}
+
+void IPCFrame::captureCamera()
+{
+	auto camIter = TObjectIterator<ACameraActor>();
+	assert(!!camIter && "need camera");
+	auto camact = *camIter;
+	auto camcom = camact->GetCameraComponent();
+	FMinimalViewInfo info;
+	camcom->GetCameraView(0, info);
+
+	float FarZ = GNearClippingPlane;
+	float NearZ = GNearClippingPlane;
+	float halfFov = info.FOV * 0.5f * PI / 180.0f;
+	float height = 600;
+	float width = info.AspectRatio * height;
+
+	mCamera.proj = FPerspectiveMatrix(halfFov, width, height, NearZ, FarZ).GetTransposed();
+
+
+	auto rot = camact->GetTransform().GetRotation().Rotator();
+	FMatrix ViewPlanesMatrix = FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+	auto rotmat = FInverseRotationMatrix(rot) * ViewPlanesMatrix;
+	auto view = FTranslationMatrix(-camact->GetTransform().GetLocation()) * rotmat;
+	mCamera.view = view.GetTransposed();
+	mCamera.dir = camact->GetTransform().ToMatrixNoScale().TransformVector({1,0,0});
+	mCamera.pos = camact->GetTransform().GetLocation();
+	mCamera.width = width;
+	mCamera.height = height;
+}
+
+void IPCFrame::iterateObjects()
+{
+	// collect unique meshes and materials first, the workers never touch UObjects
 	for (TObjectIterator<AStaticMeshActor> iter; iter; ++iter)
 	{
 		auto actor = *iter;
-		createStaticMesh(actor);
+		collectStaticMesh(actor);
 	
 	}
 
+	for (TObjectIterator<UInstancedStaticMeshComponent> iter; iter; ++iter)
+	{
+		collectInstancedStaticMesh(*iter);
+	}
+
 	for (TObjectIterator<AActor> iter; iter; ++iter)
 	{
 		auto& actor = iter;
@@ -474,38 +1825,15 @@ void IPCFrame::iterateObjects()
 		if (material == nullptr)
 			continue;
 
-		auto ret = materials.find(material->GetName());
-		if (ret != materials.end())
-		{
-		}
-		else
-		{
-			createMaterial(material, textures);
-			materials.insert(material->GetName());
-		}
-
-
-		{
-			auto ret = meshs.find(mesh->GetName());
-			if (ret != meshs.end())
-			{
-			}
-			else
-			{
-				//dstMesh = StaticMesh::Ptr(new StaticMesh(*mesh->RenderData));
-				createMesh(convert(*mesh->GetName()), *mesh->RenderData);
-				meshs.insert(mesh->GetName());
-			}
-		}
-
-		auto world = actor->GetTransform().ToMatrixWithScale().GetTransposed();
-		FVector center;
-		FVector extent;
-		actor->GetActorBounds(false, center, extent);
+		addMaterial(material);
+		addMesh(mesh);
 
-		mIPC << "createSky" << convert(*actor->GetName()) << convert(*mesh->GetName()) << convert(*material->GetName()) << world << center << extent;
+		SkyRecord sky;
+		sky.name = mNames.get(actor->GetFName());
+		sky.mesh = mNames.get(mesh->GetFName());
+		sky.material = mNames.get(material->GetFName());
+		sky.world = actor->GetTransform().ToMatrixWithScale().GetTransposed();
+		actor->GetActorBounds(false, sky.center, sky.extent);
+		mSkies.push_back(std::move(sky));
 	}
-
 }
-
-
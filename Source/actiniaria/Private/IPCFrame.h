@@ -5,28 +5,345 @@
 #include "Engine/StaticMeshActor.h"
 #include "Camera/CameraActor.h"
 #include "Camera/CameraComponent.h"
+#include "Engine/Texture.h"
+#include "UObject/GCObject.h"
 #include "nautiloidea/SimpleIPC.h"
+#include "VertexPacker.h"
+#include "MaterialIR.h"
+#include "NameTable.h"
+#include "Protocol.h"
 #include <set>
+#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
 
-class IPCFrame
+struct SubMesh
+{
+	UINT materialIndex;
+	UINT startIndex;
+	UINT numIndices;
+};
+
+struct MeshOptions
+{
+	bool simd = true;
+	VertexFormat vertexFormat = VF_Full;
+	int32 maxLODs = 0;
+	bool narrowIndices = true;
+	bool validateIndices = false;
+
+	static MeshOptions fromConsoleVariables();
+};
+
+struct LODPayload
+{
+	float screenSize = 0;
+	std::vector<char> vertices;
+	UINT numVertices = 0;
+	UINT vertexstride = 0;
+	UINT vertexformat = VF_Full;
+	// position = origin + stored position * scale
+	FVector origin = FVector::ZeroVector;
+	FVector scale = FVector(1.0f, 1.0f, 1.0f);
+	std::vector<char> indices;
+	UINT numIndices = 0;
+	UINT indexstride = 0;
+	std::vector<SubMesh> subs;
+};
+
+// OP_CreateMesh content, built on worker threads without touching UObjects
+struct MeshPayload
+{
+	std::string name;
+	std::vector<LODPayload> lods;
+};
+
+struct InstanceData
+{
+	FMatrix world;
+	FMatrix nworld;
+	FVector center;
+	FVector extent;
+};
+
+// models sharing mesh and material list, sent as OP_CreateModel when there is a single instance
+struct InstanceGroup
+{
+	std::string name;
+	std::string mesh;
+	std::vector<std::string> materials;
+	std::vector<InstanceData> instances;
+};
+
+struct SkyRecord
+{
+	std::string name;
+	std::string mesh;
+	std::string material;
+	FMatrix world;
+	FVector center;
+	FVector extent;
+};
+
+struct CameraRecord
+{
+	FVector pos;
+	FVector dir;
+	FMatrix view;
+	FMatrix proj;
+	float width;
+	float height;
+};
+
+struct MeshSource
+{
+	UStaticMesh* mesh;
+	std::string name;
+};
+
+// render data of one lod copied on the game thread, a mesh rebuild may free the live data while it is packed
+struct LODSource
+{
+	float screenSize = 0;
+	FPositionVertexBuffer positions;
+	FStaticMeshVertexBuffer vertices;
+	FColorVertexBuffer colors;
+	// raw index stream, 4 bytes per index when is32Bit
+	std::vector<char> indices;
+	bool is32Bit = false;
+	std::vector<SubMesh> subs;
+};
+
+struct MeshSnapshot
+{
+	std::string name;
+	// derived data key of the render data, empty without one
+	FString key;
+	FBoxSphereBounds bounds;
+	std::vector<std::unique_ptr<LODSource>> lods;
+};
+
+// texture referenced by a translated material, the mip is read when it is sent
+struct TextureRecord
+{
+	std::string name;
+	UTexture* texture;
+	uint32 width;
+	uint32 height;
+	ETextureSourceFormat format;
+	bool srgb;
+	// EMaterialSamplerType of the first sampler using the texture, picks the block format
+	uint32 samplerType;
+	FString key;
+	// index into the texture arrays when the texture was packed, -1 when it is sent on its own
+	int32 array = -1;
+	uint32 slice = 0;
+};
+
+// small textures of the same size and format sent as one Texture2DArray, layers index the texture queue
+struct TextureArray
+{
+	std::string name;
+	std::vector<size_t> layers;
+};
+
+struct TextureMip
+{
+	uint32 width;
+	uint32 height;
+	std::vector<char> data;
+};
+
+// OP_CreateTexture content, mips are ordered from the most detailed
+struct TexturePayload
+{
+	UINT format = 0;
+	std::vector<TextureMip> mips;
+};
+
+struct MaterialRecord
+{
+	std::string name;
+	// shared by the instances of a base material when parameters are read from a constant buffer
+	std::string pixelShader;
+	std::string shader;
+	std::set<std::string> textures;
+	// MaterialParameters constant buffer content, empty when parameters are baked into the shader
+	std::vector<float> parameters;
+	// set by translateMaterial when the shader was neither generated before nor cached, compiled on the sending thread
+	std::shared_ptr<MaterialGraph> graph;
+	FString key;
+};
+
+struct LightRecord
+{
+	std::string name;
+	FLinearColor color;
+	FVector dir;
+};
+
+struct CaptureRecord
+{
+	std::string name;
+	FMatrix world;
+	float radius;
+	float brightness;
+	UINT cubemapSize;
+	TArray<uint8> data;
+};
+
+// shared between the thread running IPCFrame::send and the editor
+struct ExportProgress
+{
+	std::atomic<int32> completed{ 0 };
+	std::atomic<int32> total{ 0 };
+	std::atomic<bool> connected{ false };
+	std::atomic<bool> cancelled{ false };
+	// set once the scene is sent and mip requests are served
+	std::atomic<bool> streaming{ false };
+	std::atomic<int32> served{ 0 };
+};
+
+// texture whose detailed mips are sent on request, firstMip is the most detailed level the receiver has
+struct StreamedTexture
+{
+	size_t record;
+	UINT firstMip;
+};
+
+class IPCFrame : public FGCObject
 {
 public:
 	IPCFrame();
 	~IPCFrame();
 
-	void init();
+	// snapshot of the scene, game thread only. material graphs are copied here, their shaders are generated by send()
+	void capture();
+	// connects and sends the captured scene, safe to run on any thread.
+	// returns false when progress->cancelled was set, the receiver gets OP_Cancel instead of OP_Done,
+	// or when the receiver speaks another protocol version
+	bool send(ExportProgress* progress = nullptr);
+	// answers OP_RequestTextureMips and stores returned shader bytecode after send() until the receiver ends streaming, false if cancelled
+	bool serveRequests(ExportProgress& progress);
+
+	// live sync deltas after capture() and send(), commit() closes the batch of deltas sent in one editor tick
+	void setInstancing(bool enable) { mInstancing = enable; }
+	void setTextureStreaming(bool enable) { mTextureStreaming = enable && mTextureMips; }
+	void setTexturePacking(bool enable) { mTexturePacking = enable; }
+	// asks the receiver to return the bytecode of the shaders it compiles, read by serveRequests
+	void setCollectBytecode(bool enable) { mCollectBytecode = enable; }
+	void addActor(AActor* actor);
+	void updateActor(AActor* actor);
+	void destroyActor(const FString& actorname);
+	void updateMaterial(UMaterialInterface* changed);
+	void commit();
+
+	// mip 0 of texture encoded as the export sends it with the current console variables, empty for source formats
+	// the export does not convert. game thread only, for the payload benchmarks
+	static std::vector<char> encodeTopMip(class UTexture2D* texture);
+
+	virtual void AddReferencedObjects(FReferenceCollector& collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("actiniaria IPCFrame"); }
 private:
+	// false if the handshake found another protocol version or the receiver picked a codec that was not offered
+	bool connect();
+	// ends the message begun on mEncoder and writes its frames to the batch
+	void sendMessage();
+	void captureCamera();
 	void iterateObjects();
 	void iterateLights();
 	void iterateCapture();
+	void translateMaterials();
+	bool sendQueued(ExportProgress& progress);
+	bool sendTextures(ExportProgress& progress);
+	bool sendMaterials(ExportProgress& progress);
+	static bool step(ExportProgress& progress);
 
-	void createMesh(const std::string& name, FStaticMeshRenderData & renderdata);
-	void createStaticMesh(AStaticMeshActor* actor);
-	void createMaterial(UMaterialInterface* material,  std::set<std::string>& textureMap);
-	void createSkySphere(const std::string& name, const std::string& meshname, const std::string& mat, const FMatrix& tran);
+	// game thread only
+	static std::shared_ptr<MeshSnapshot> snapshotMesh(const MeshSource& source, const MeshOptions& options);
+	static MeshPayload buildMesh(const MeshSnapshot& snapshot, const MeshOptions& options, const class ExportCache* cache);
+	static void buildLOD(LODPayload& payload, const std::string& name, const LODSource& lod, const FBoxSphereBounds& bounds, const MeshOptions& options);
+	void sendMesh(const MeshPayload& payload);
+	void sendLOD(const LODPayload& payload);
+	void collectStaticMesh(AStaticMeshActor* actor);
+	void collectInstancedStaticMesh(class UInstancedStaticMeshComponent* component);
+	bool collectMaterials(UStaticMeshComponent* component, std::vector<std::string>& mats);
+	void addInstance(const std::string& name, UStaticMesh* mesh, const std::vector<std::string>& mats, const FTransform& transform, const FVector& center, const FVector& extent);
+	void sendInstanceGroup(const InstanceGroup& group);
+	void addMaterial(UMaterialInterface* material);
+	void addMesh(UStaticMesh* mesh);
+	void sendPayload(const void* data, UINT size, UINT type);
+	MaterialRecord captureMaterial(UMaterialInterface* material);
+	void collectTextures(UMaterialInterface* material, MaterialRecord& record);
+	void translateMaterial(UMaterialInterface* material, MaterialRecord& record);
+	void compileMaterials(MaterialRecord* records, size_t count);
+	void writeParameters(const std::vector<float>& parameters);
+	void packTextures();
+	void sendMaterial(const MaterialRecord& record, Opcode opcode = OP_CreateMaterial);
+	TexturePayload loadTexture(const TextureRecord& record, bool alpha = false) const;
+	void sendTexture(size_t index);
+	void sendTextureArray(const TextureArray& array);
+	void sendMip(const TexturePayload& payload, UINT level);
+	// false if the texture is not streamed or the receiver already has the level
+	bool sendTextureMips(const std::string& name, UINT level);
+	LightRecord captureLight(class ADirectionalLight* light);
+	void sendLight(const LightRecord& light, Opcode opcode);
+	void sendCapture(const CaptureRecord& capture);
+	void sendPending();
 public:
 	SimpleIPC mIPC;
 	std::set<FString> meshs;
 	std::set<FString> materials;
 	std::set<std::string> textures;
+
+private:
+	std::unique_ptr<class SharedArena> mArena;
+	std::unique_ptr<class ExportCache> mCache;
+	NameTable mNames;
+	// only used by the thread writing mIPC
+	ProtocolEncoder mEncoder;
+	// every write to mIPC after the handshake goes through it, flushed before reading from mIPC
+	std::unique_ptr<class BatchWriter> mWriter;
+	// set when the handshake picked a payload codec, mCompressed holds the payload being sent
+	std::unique_ptr<class PayloadCompressor> mCompressor;
+	std::vector<char> mCompressed;
+	CameraRecord mCamera;
+	std::vector<MeshSource> mMeshQueue;
+	std::vector<TWeakObjectPtr<UMaterialInterface>> mMaterialQueue;
+	std::vector<MaterialRecord> mMaterialRecords;
+	std::vector<TextureRecord> mTextureQueue;
+	std::map<std::string, size_t> mTextureIndices;
+	std::vector<TextureArray> mTextureArrays;
+	std::vector<InstanceGroup> mInstanceGroups;
+	std::vector<LightRecord> mLights;
+	std::vector<CaptureRecord> mCaptures;
+	size_t mMeshesSent = 0;
+	size_t mMaterialsTranslated = 0;
+	size_t mMaterialsSent = 0;
+	size_t mTexturesSent = 0;
+	size_t mTexturesPacked = 0;
+	size_t mTextureArraysSent = 0;
+	size_t mInstanceGroupsSent = 0;
+	// generated shaders by pixel shader name, empty while the shader waits in compileMaterials, and the names the receiver already has
+	std::map<std::string, std::string> mPixelShaders;
+	std::set<std::string> mShadersSent;
+	size_t mBytecodeRequests = 0;
+	bool mCollectBytecode = true;
+	std::set<std::string> mModelNames;
+	std::set<std::string> mLightNames;
+	std::map<std::string, size_t> mInstanceGroupIndices;
+	bool mInstancing = true;
+	bool mParameterBuffers = true;
+	// MaterialCompiler::Option flags, read once so every shader of an export is generated the same way
+	uint32 mMaterialOptions = 0;
+	bool mTextureCompression = true;
+	bool mTextureMips = true;
+	bool mMipsCoarseToFine = false;
+	bool mTextureStreaming = true;
+	uint32 mStreamingTailSize = 256;
+	bool mTexturePacking = false;
+	uint32 mTexturePackingMaxSize = 256;
+	std::map<std::string, StreamedTexture> mStreamedTextures;
+	std::vector<SkyRecord> mSkies;
 };
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "LiveSync.h"
+#include "IPCFrame.h"
+#include "ExportJob.h"
+
+#include "Engine/Engine.h"
+#include "Engine/DirectionalLight.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInterface.h"
+#include "Components/ActorComponent.h"
+#include "UObject/UObjectGlobals.h"
+
+LiveSync::LiveSync()
+{
+	mJob = std::make_unique<ExportJob>([](IPCFrame& frame)
+	{
+		// deltas address models by actor name, so every actor is its own model
+		frame.setInstancing(false);
+		// the pipe is not read while syncing, so every texture is sent complete and no shader bytecode is returned
+		frame.setTextureStreaming(false);
+		frame.setCollectBytecode(false);
+		// updateMaterial translates one material at a time, there is nothing to pack it with
+		frame.setTexturePacking(false);
+	}, true);
+	mTicker = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &LiveSync::tick));
+}
+
+void LiveSync::start()
+{
+	mFrame = mJob->releaseFrame();
+	mJob.reset();
+	if (!mFrame)
+		return;
+
+	// changes made while the export ran are in the snapshot or lost, the actors are not tracked before this
+	mActorMoved = GEngine->OnActorMoved().AddRaw(this, &LiveSync::onActorMoved);
+	mActorAdded = GEngine->OnLevelActorAdded().AddRaw(this, &LiveSync::onActorAdded);
+	mActorDeleted = GEngine->OnLevelActorDeleted().AddRaw(this, &LiveSync::onActorDeleted);
+	mPropertyChanged = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &LiveSync::onObjectPropertyChanged);
+	mMaterialCompiled = UMaterial::OnMaterialCompilationFinished().AddRaw(this, &LiveSync::onMaterialCompiled);
+}
+
+LiveSync::~LiveSync()
+{
+	FTicker::GetCoreTicker().RemoveTicker(mTicker);
+	UMaterial::OnMaterialCompilationFinished().Remove(mMaterialCompiled);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(mPropertyChanged);
+	if (GEngine)
+	{
+		GEngine->OnLevelActorDeleted().Remove(mActorDeleted);
+		GEngine->OnLevelActorAdded().Remove(mActorAdded);
+		GEngine->OnActorMoved().Remove(mActorMoved);
+	}
+	// cancels an export still running
+	mJob.reset();
+}
+
+bool LiveSync::tick(float delta)
+{
+	if (mJob)
+	{
+		if (!mJob->isRunning())
+			start();
+		return true;
+	}
+	if (!mFrame)
+		return true;
+
+	if (mAdded.Num() + mMoved.Num() + mReplaced.Num() + mDeleted.Num() + mMaterials.Num() == 0)
+		return true;
+
+	for (auto& name : mDeleted)
+		mFrame->destroyActor(name);
+
+	for (auto& actor : mReplaced)
+	{
+		if (!actor.IsValid())
+			continue;
+		mFrame->destroyActor(actor->GetName());
+		mFrame->addActor(actor.Get());
+	}
+
+	for (auto& actor : mAdded)
+	{
+		if (actor.IsValid())
+			mFrame->addActor(actor.Get());
+	}
+
+	for (auto& actor : mMoved)
+	{
+		if (actor.IsValid() && !mAdded.Contains(actor) && !mReplaced.Contains(actor))
+			mFrame->updateActor(actor.Get());
+	}
+
+	for (auto& material : mMaterials)
+	{
+		if (material.IsValid())
+			mFrame->updateMaterial(material.Get());
+	}
+
+	mFrame->commit();
+
+	mAdded.Reset();
+	mMoved.Reset();
+	mReplaced.Reset();
+	mDeleted.Reset();
+	mMaterials.Reset();
+	return true;
+}
+
+void LiveSync::onActorMoved(AActor* actor)
+{
+	mMoved.Add(actor);
+}
+
+void LiveSync::onActorAdded(AActor* actor)
+{
+	mAdded.Add(actor);
+	mDeleted.Remove(actor->GetName());
+}
+
+void LiveSync::onActorDeleted(AActor* actor)
+{
+	mAdded.Remove(actor);
+	mMoved.Remove(actor);
+	mReplaced.Remove(actor);
+	mDeleted.Add(actor->GetName());
+}
+
+void LiveSync::onObjectPropertyChanged(UObject* object, FPropertyChangedEvent& event)
+{
+	if (auto material = Cast<UMaterialInterface>(object))
+	{
+		mMaterials.Add(material);
+		return;
+	}
+
+	if (auto component = Cast<UActorComponent>(object))
+		object = component->GetOwner();
+
+	auto actor = Cast<AActor>(object);
+	if (actor == nullptr)
+		return;
+
+	// light color and brightness live on the component, a light update resends everything
+	if (actor->IsA<ADirectionalLight>())
+		mMoved.Add(actor);
+	else if (actor->IsA<AStaticMeshActor>())
+		mReplaced.Add(actor);
+}
+
+void LiveSync::onMaterialCompiled(UMaterialInterface* material)
+{
+	mMaterials.Add(material);
+}
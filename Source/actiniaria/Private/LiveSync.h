@@ -0,0 +1,54 @@
+#pragma once
+#include "Core.h"
+#include "UObject/WeakObjectPtr.h"
+#include "Containers/Ticker.h"
+
+#include <memory>
+
+class IPCFrame;
+class ExportJob;
+class AActor;
+class UMaterialInterface;
+struct FPropertyChangedEvent;
+
+// keeps the render station in sync with the editor after a full export.
+// the export runs as an ExportJob, editor notifications are only collected once it is complete and then sent as
+// delta messages once per tick
+class LiveSync
+{
+public:
+	LiveSync();
+	~LiveSync();
+
+	// false once the initial export failed or was cancelled
+	bool isRunning() const { return mJob || mFrame; }
+
+private:
+	bool tick(float delta);
+	// takes the frame of the finished export and starts collecting deltas
+	void start();
+
+	void onActorMoved(AActor* actor);
+	void onActorAdded(AActor* actor);
+	void onActorDeleted(AActor* actor);
+	void onObjectPropertyChanged(UObject* object, FPropertyChangedEvent& event);
+	void onMaterialCompiled(UMaterialInterface* material);
+
+private:
+	std::unique_ptr<ExportJob> mJob;
+	std::unique_ptr<IPCFrame> mFrame;
+
+	TSet<TWeakObjectPtr<AActor>> mAdded;
+	TSet<TWeakObjectPtr<AActor>> mMoved;
+	// actors whose mesh or materials changed, recreated as a whole
+	TSet<TWeakObjectPtr<AActor>> mReplaced;
+	TSet<FString> mDeleted;
+	TSet<TWeakObjectPtr<UMaterialInterface>> mMaterials;
+
+	FDelegateHandle mTicker;
+	FDelegateHandle mActorMoved;
+	FDelegateHandle mActorAdded;
+	FDelegateHandle mActorDeleted;
+	FDelegateHandle mPropertyChanged;
+	FDelegateHandle mMaterialCompiled;
+};
@@ -0,0 +1,805 @@
+#include "MaterialCompiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static std::string format()
+{
+	return {};
+}
+
+template<class T, class ... Args>
+static std::string format(const T& v, Args&& ... args)
+{
+	std::stringstream ss;
+	ss << v << format(args...);
+	return ss.str();
+}
+
+// swizzle of the output pins that select one channel, the other outputs are the whole value
+static const char* getChannelSwizzle(const std::string& output)
+{
+	if (output == "R")
+		return ".r";
+	if (output == "G")
+		return ".g";
+	if (output == "B")
+		return ".b";
+	if (output == "A")
+		return ".a";
+	return "";
+}
+
+static bool isChannel(const std::string& output)
+{
+	return output == "R" || output == "G" || output == "B" || output == "A";
+}
+
+// width of an elementwise result, scalars broadcast and mixed vector widths are truncated to the narrower one like hlsl does.
+// 0 stands for an unknown width
+static uint32_t combineComponents(std::initializer_list<uint32_t> counts)
+{
+	uint32_t result = 1;
+	for (auto c : counts)
+	{
+		if (c == 0)
+			return 0;
+		if (c > 1)
+			result = result == 1 ? c : std::min(result, c);
+	}
+	return result;
+}
+
+std::string MaterialCompiler::getParameterField(const std::string& name, bool vector)
+{
+	return (vector ? "_v_" : "_s_") + sanitizeName(name);
+}
+
+const std::map<std::string, MaterialCompiler::Handler>& MaterialCompiler::getHandlers()
+{
+	// built once and only read afterwards, every handler gets the compiler whose state it updates
+	static const std::map<std::string, Handler> handlers = {
+		{ "VectorParameter", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			if (c.mOptions & MO_ParameterBuffers)
+			{
+				ss << getParameterField(node.getString("Parameter"), true) << getChannelSwizzle(output);
+				return;
+			}
+
+			if (output == "R")
+				ss << node.getValue("R");
+			else if (output == "G")
+				ss << node.getValue("G");
+			else if (output == "B")
+				ss << node.getValue("B");
+			else if (output == "A")
+				ss << node.getValue("A");
+			else
+				ss << "half4(" << node.getValue("R") << "," << node.getValue("G") << "," << node.getValue("B") << "," << node.getValue("A") << ")";
+		} },
+		{ "LinearInterpolate", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const float constA = node.getValue("ConstA");
+			const float constB = node.getValue("ConstB");
+			const float constAlpha = node.getValue("ConstAlpha");
+
+			// a constant alpha of 0 or 1 picks one side, unless the other side would have widened the result
+			const uint32_t width = combineComponents({ c.getInputComponentCount(node, 0), c.getInputComponentCount(node, 1), c.getInputComponentCount(node, 2) });
+			if (c.isConstantInput(node, 2, constAlpha, 0.0f) && width != 0 && c.getInputComponentCount(node, 0) == width)
+			{
+				c.emitInput(node, 0, constA, ss);
+				return;
+			}
+			if (c.isConstantInput(node, 2, constAlpha, 1.0f) && width != 0 && c.getInputComponentCount(node, 1) == width)
+			{
+				c.emitInput(node, 1, constB, ss);
+				return;
+			}
+
+			ss << "lerp(";
+			c.emitInput(node, 0, constA, ss);
+			ss << ",";
+			c.emitInput(node, 1, constB, ss);
+			ss << ",";
+			c.emitInput(node, 2, constAlpha, ss);
+			ss << ")";
+		} },
+		{ "Multiply", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const float constA = node.getValue("ConstA");
+			const float constB = node.getValue("ConstB");
+			if (c.isConstantInput(node, 1, constB, 1.0f))
+			{
+				c.emitInput(node, 0, constA, ss);
+				return;
+			}
+			if (c.isConstantInput(node, 0, constA, 1.0f))
+			{
+				c.emitInput(node, 1, constB, ss);
+				return;
+			}
+
+			c.emitInput(node, 0, constA, ss);
+			ss << " * ";
+			c.emitInput(node, 1, constB, ss);
+		} },
+		{ "Add", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const float constA = node.getValue("ConstA");
+			const float constB = node.getValue("ConstB");
+			if (c.isConstantInput(node, 1, constB, 0.0f))
+			{
+				c.emitInput(node, 0, constA, ss);
+				return;
+			}
+			if (c.isConstantInput(node, 0, constA, 0.0f))
+			{
+				c.emitInput(node, 1, constB, ss);
+				return;
+			}
+
+			c.emitInput(node, 0, constA, ss);
+			ss << " + ";
+			c.emitInput(node, 1, constB, ss);
+		} },
+		{ "Subtract", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const float constA = node.getValue("ConstA");
+			const float constB = node.getValue("ConstB");
+			if (c.isConstantInput(node, 1, constB, 0.0f))
+			{
+				c.emitInput(node, 0, constA, ss);
+				return;
+			}
+
+			c.emitInput(node, 0, constA, ss);
+			ss << " - ";
+			c.emitInput(node, 1, constB, ss);
+		} },
+		{ "Divide", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const float constA = node.getValue("ConstA");
+			const float constB = node.getValue("ConstB");
+			if (c.isConstantInput(node, 1, constB, 1.0f))
+			{
+				c.emitInput(node, 0, constA, ss);
+				return;
+			}
+
+			c.emitInput(node, 0, constA, ss);
+			ss << "/";
+			c.emitInput(node, 1, constB, ss);
+		} },
+		{ "ScalarParameter", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			if (c.mOptions & MO_ParameterBuffers)
+				ss << getParameterField(node.getString("Parameter"), false);
+			else
+				ss << node.getValue("Value");
+		} },
+		{ "TextureSample", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			const std::string& texture = node.getString("Texture");
+
+			// bind resource, packed textures share the binding of their array
+			auto slice = c.mGraph->textureSlices.find(texture);
+			if (slice != c.mGraph->textureSlices.end())
+			{
+				if (c.mBoundResources.find(slice->second.array) == c.mBoundResources.end())
+					c.mBoundResources[slice->second.array] = "Texture2DArray " + slice->second.array;
+			}
+			else if (c.mBoundResources.find(texture) == c.mBoundResources.end())
+			{
+				c.mBoundResources[texture] = "Texture2D " + toVariableName(texture);
+			}
+
+			// define variable and sample texture
+			if (c.mDefinitions.insert(node.name).second)
+			{
+				std::string uv = "input.uv";
+				if (isLinked(node, 0))
+					uv = c.parseToString(node.inputs[0]);
+
+				std::string sample = toVariableName(texture) + ".Sample(anisotropicSampler," + uv + ")";
+				if (slice != c.mGraph->textureSlices.end())
+					sample = slice->second.array + ".Sample(anisotropicSampler,float3((" + uv + ").xy," + std::to_string(slice->second.slice) + "))";
+				// normal maps may arrive as BC5 which has no blue channel
+				if (node.getValue("Normal") != 0)
+				{
+					c.mReconstructNormals = true;
+					sample = "reconstructNormalZ(" + sample + ")";
+				}
+				c.mStatements.push_back("half4 " + node.name + " = " + sample);
+			}
+
+			ss << node.name << getChannelSwizzle(output);
+		} },
+		{ "Constant", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << node.getValue("R");
+		} },
+		{ "Fresnel", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << 0.5f;
+		} },
+		{ "Constant3Vector", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "half4(" << node.getValue("R") << "," << node.getValue("G") << "," << node.getValue("B") << "," << node.getValue("B") << ")";
+		} },
+		{ "TextureCoordinate", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "input.uv * half2(" << node.getValue("UTiling", 1.0f) << "," << node.getValue("VTiling", 1.0f) << ")";
+		} },
+		{ "Clamp", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "clamp(";
+			c.parseInput(node, 0, ss);
+			ss << ", ";
+			c.emitInput(node, 1, node.getValue("MinDefault"), ss);
+			ss << ", ";
+			c.emitInput(node, 2, node.getValue("MaxDefault", 1.0f), ss);
+			ss << ")";
+		} },
+		{ "VertexColor", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "input.color";
+			if (output == "Output2")
+				ss << ".r";
+			else if (output == "Output3")
+				ss << ".g";
+			else if (output == "Output4")
+				ss << ".b";
+			else if (output == "Output5")
+				ss << ".a";
+		} },
+		{ "Panner", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			std::string uv = isLinked(node, 0) ? c.parseToString(node.inputs[0]) : "input.uv";
+			std::string time = isLinked(node, 1) ? c.parseToString(node.inputs[1]) : "deltatime";
+			std::string speed = isLinked(node, 2) ? c.parseToString(node.inputs[2]) :
+				format("half2(", node.getValue("SpeedX"), ",", node.getValue("SpeedY"), ")");
+			ss << format(uv, " + ", speed, " * ", time);
+		} },
+		{ "ComponentMask", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			c.parseInput(node, 0, ss);
+			ss << ".";
+			if (node.getValue("R") != 0)
+				ss << "r";
+			if (node.getValue("G") != 0)
+				ss << "g";
+			if (node.getValue("B") != 0)
+				ss << "b";
+			if (node.getValue("A") != 0)
+				ss << "a";
+		} },
+		{ "OneMinus", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "1 - ";
+			c.parseInput(node, 0, ss);
+		} },
+		{ "Power", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "pow(";
+			c.parseInput(node, 0, ss);
+			ss << ",";
+			c.emitInput(node, 1, node.getValue("ConstExponent", 2.0f), ss);
+			ss << ")";
+		} },
+		{ "SphereMask", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			std::string hardness = format(node.getValue("HardnessPercent") * 0.01f);
+			if (isLinked(node, 3))
+				hardness = c.parseToString(node.inputs[3]) + " * 0.01f";
+
+			std::stringstream origin;
+			c.parseInput(node, 0, origin);
+			std::stringstream checkpoint;
+			c.parseInput(node, 1, checkpoint);
+
+			std::string radius = format(node.getValue("AttenuationRadius"));
+			if (isLinked(node, 2))
+				radius = c.parseToString(node.inputs[2]);
+
+			const std::string distance = format("length(", checkpoint.str(), " - ", origin.str(), ")/", radius);
+			if (hardness == "1" || hardness == "1.0")
+			{
+				ss << "1- floor(clamp(" << distance << ",0,1))";
+			}
+			else
+			{
+				ss << "clamp(" << hardness << "1 / (1 - " << hardness << ") * (1.0f - clamp(";
+				ss << distance << ",0,1.0f))" << ",0,1.0f)";
+			}
+		} },
+		{ "Normalize", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "normalize(";
+			c.parseInput(node, 0, ss);
+			ss << ".xyz)";
+		} },
+		{ "CrossProduct", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "cross(";
+			c.parseInput(node, 0, ss);
+			ss << ".xyz,";
+			c.parseInput(node, 1, ss);
+			ss << ".xyz)";
+		} },
+		{ "DotProduct", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "dot(";
+			c.parseInput(node, 0, ss);
+			ss << ".xyz,";
+			c.parseInput(node, 1, ss);
+			ss << ".xyz)";
+		} },
+		{ "CameraVectorWS", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "V";
+		} },
+		{ "CameraPositionWS", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "campos";
+		} },
+		{ "ObjectPositionWS", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "objpos";
+		} },
+		{ "ObjectRadius", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "objradius";
+		} },
+		{ "WorldPosition", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			ss << "input.worldPos.xyz";
+		} },
+		{ "Time", [](MaterialCompiler& c, const MaterialNode& node, const std::string& output, std::stringstream& ss)
+		{
+			if (node.getValue("OverridePeriod") != 0)
+				ss << "fmod(time, " << node.getValue("Period") << ")";
+			else
+				ss << "time";
+		} },
+	};
+	return handlers;
+}
+
+std::string MaterialCompiler::compile(const MaterialGraph& graph)
+{
+	mGraph = &graph;
+	mBoundResources.clear();
+	mDefinitions.clear();
+	mStatements.clear();
+	mUses.clear();
+	mTemporaries.clear();
+	mComponents.clear();
+	mConstants.clear();
+	mErrors.clear();
+	mNumEvaluations = 0;
+	mReconstructNormals = false;
+
+	// reads of every output in the graph, the ones read more than once become temporaries
+	for (auto& output : graph.outputs)
+		countUses(output.link);
+
+	std::stringstream ss;
+
+	struct Requirement
+	{
+		bool exist = false;
+		std::string type;
+		std::string value;
+	};
+	std::map<std::string, Requirement> required;
+
+	required["Base Color"] = { false, "half3", "0.0f" };
+	required["Roughness"] = { false, "half", format(graph.roughness) };
+	required["Metallic"] = { false, "half", format(graph.metallic) };
+	required["Emissive Color"] = { false, "half3", "0.0f" };
+
+	auto toIdentifier = [](std::string name)
+	{
+		std::replace(name.begin(), name.end(), ' ', '_');
+		return name;
+	};
+
+	for (auto& output : graph.outputs)
+	{
+		auto ret = required.find(output.name);
+		if (ret != required.end())
+			ret->second.exist = true;
+
+		const std::string type = output.components == 1 ? std::string("half") : "half" + std::to_string(output.components);
+		ss << "	" << type << " " << toIdentifier(output.name) << " = ";
+		parse(output.link, ss);
+		ss << ";\n";
+	}
+
+	for (auto& r : required)
+	{
+		if (!r.second.exist)
+			ss << "	" << r.second.type << " " << toIdentifier(r.first) << " = " << r.second.value << ";\n";
+	}
+
+	std::string shader;
+	for (auto& m : std::set<std::string>(graph.macros.begin(), graph.macros.end()))
+		shader += "#define " + m + "\n";
+	std::vector<std::string> headers = {
+		"common.hlsl",
+		"pbr.hlsl",
+	};
+	for (auto& h : headers)
+		shader += std::string("#include ") + "\"" + h + "\"\n";
+
+	for (auto& r : mBoundResources)
+		shader += r.second + ";\n";
+
+	if ((mOptions & MO_ParameterBuffers) && (!graph.vectorParameters.empty() || !graph.scalarParameters.empty()))
+	{
+		shader += "cbuffer MaterialParameters\n{\n";
+		for (auto& v : graph.vectorParameters)
+			shader += "	float4 " + getParameterField(v, true) + ";\n";
+		for (auto& s : graph.scalarParameters)
+			shader += "	float " + getParameterField(s, false) + ";\n";
+		shader += "};\n";
+	}
+
+	shader += "__BOUND_RESOURCE__  \n";
+
+	shader += "sampler pointSampler:register(s0);\n";
+	shader += "sampler linearSampler:register(s1);\n";
+	shader += "sampler linearClamp:register(s2);\n";
+	shader += "sampler anisotropicSampler:register(s3);\n";
+
+	if (mReconstructNormals)
+	{
+		shader += "half4 reconstructNormalZ(half4 n)\n{\n";
+		shader += "	half2 xy = n.rg * 2 - 1;\n";
+		shader += "	n.b = sqrt(saturate(1 - dot(xy, xy))) * 0.5 + 0.5;\n";
+		shader += "	return n;\n}\n";
+	}
+
+	shader += "half4 ps(PSInput input):SV_TARGET \n{\n";
+	shader += "	half3 V = normalize(campos.xyz - input.worldPos.xyz);\n";
+
+	for (auto& d : mStatements)
+		shader += "	" + d + ";\n";
+
+	shader += ss.str();
+
+	shader += "#ifdef HAS_NORMALMAP\n";
+	shader += "	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);\n";
+	shader += "#else\n";
+	shader += "	half3 _normal = input.normal.xyz;\n";
+	shader += "#endif\n";
+
+	shader += "	__SHADER_CONTENT__";
+	shader += "\n\n}\n\n";
+
+	mGraph = nullptr;
+	return shader;
+}
+
+bool MaterialCompiler::isLinked(const MaterialNode& node, size_t index)
+{
+	return index < node.inputs.size() && node.inputs[index].node >= 0;
+}
+
+void MaterialCompiler::parseInput(const MaterialNode& node, size_t index, std::stringstream& ss)
+{
+	parse(index < node.inputs.size() ? node.inputs[index] : MaterialLink(), ss);
+}
+
+std::string MaterialCompiler::parseToString(const MaterialLink& link)
+{
+	std::stringstream ss;
+	parse(link, ss);
+	return ss.str();
+}
+
+void MaterialCompiler::countUses(const MaterialLink& link)
+{
+	if (link.node < 0 || (size_t)link.node >= mGraph->nodes.size())
+		return;
+	// inputs of an output are only walked on its first read, the graph is a DAG
+	if (mUses[OutputKey(link.node, link.output)]++ > 0)
+		return;
+	for (auto& input : mGraph->nodes[link.node].inputs)
+		countUses(input);
+}
+
+uint32_t MaterialCompiler::getComponentCount(const MaterialLink& link)
+{
+	// width of the hlsl value the handler of the output emits, 0 if it is not known
+	if (link.node < 0 || (size_t)link.node >= mGraph->nodes.size())
+		return 0;
+	const OutputKey key(link.node, link.output);
+	auto ret = mComponents.find(key);
+	if (ret != mComponents.end())
+		return ret->second;
+
+	const MaterialNode& node = mGraph->nodes[link.node];
+	auto input = [&](size_t index, uint32_t unlinked)
+	{
+		if (!isLinked(node, index))
+			return unlinked;
+		return getComponentCount(node.inputs[index]);
+	};
+
+	uint32_t count = 0;
+	const std::string& kind = node.kind;
+	if (kind == "Constant" || kind == "ScalarParameter" || kind == "Time" || kind == "ObjectRadius" || kind == "Fresnel" ||
+		kind == "SphereMask" || kind == "DotProduct")
+		count = 1;
+	else if (kind == "VectorParameter" || kind == "TextureSample")
+		count = isChannel(link.output) ? 1 : 4;
+	else if (kind == "Constant3Vector")
+		count = 4;
+	else if (kind == "TextureCoordinate")
+		count = 2;
+	else if (kind == "WorldPosition" || kind == "CameraVectorWS" || kind == "Normalize" || kind == "CrossProduct")
+		count = 3;
+	else if (kind == "ComponentMask")
+		count = (node.getValue("R") != 0) + (node.getValue("G") != 0) + (node.getValue("B") != 0) + (node.getValue("A") != 0);
+	else if (kind == "OneMinus")
+		count = input(0, 0);
+	else if (kind == "Panner")
+		count = combineComponents({ input(0, 2), input(2, 2), input(1, 1) });
+	else if (kind == "Multiply" || kind == "Add" || kind == "Subtract" || kind == "Divide" || kind == "Power")
+		count = combineComponents({ input(0, 1), input(1, 1) });
+	else if (kind == "LinearInterpolate" || kind == "Clamp")
+		count = combineComponents({ input(0, 1), input(1, 1), input(2, 1) });
+
+	mComponents[key] = count;
+	return count;
+}
+
+uint32_t MaterialCompiler::getInputComponentCount(const MaterialNode& node, size_t index)
+{
+	if (!isLinked(node, index))
+		return 1;
+	return getComponentCount(node.inputs[index]);
+}
+
+void MaterialCompiler::emitInput(const MaterialNode& node, size_t index, float unlinked, std::stringstream& ss)
+{
+	if (!isLinked(node, index))
+		ss << unlinked;
+	else
+		parse(node.inputs[index], ss);
+}
+
+bool MaterialCompiler::isConstantInput(const MaterialNode& node, size_t index, float unlinked, float value)
+{
+	if (!(mOptions & MO_ConstantFolding))
+		return false;
+	if (!isLinked(node, index))
+		return unlinked == value;
+	ConstantValue constant;
+	return evaluate(node.inputs[index], constant) && constant.count == 1 && constant.value[0] == value;
+}
+
+std::string MaterialCompiler::toLiteral(const ConstantValue& constant)
+{
+	if (constant.count == 1)
+		return format(constant.value[0]);
+	std::string literal = "half" + std::to_string(constant.count) + "(";
+	for (uint32_t i = 0; i < constant.count; ++i)
+		literal += (i > 0 ? "," : "") + format(constant.value[i]);
+	return literal + ")";
+}
+
+bool MaterialCompiler::evaluate(const MaterialLink& link, ConstantValue& result)
+{
+	if (link.node < 0 || (size_t)link.node >= mGraph->nodes.size())
+		return false;
+	const OutputKey key(link.node, link.output);
+	auto ret = mConstants.find(key);
+	if (ret != mConstants.end())
+	{
+		result = ret->second;
+		return result.count > 0;
+	}
+	// not constant until proven otherwise, also ends a cycle in a broken graph
+	mConstants[key] = ConstantValue();
+
+	const MaterialNode& node = mGraph->nodes[link.node];
+	auto scalar = [](float v)
+	{
+		ConstantValue c;
+		c.count = 1;
+		c.value[0] = v;
+		return c;
+	};
+	auto linked = [&](size_t index, ConstantValue& c)
+	{
+		return isLinked(node, index) && evaluate(node.inputs[index], c);
+	};
+	auto operand = [&](size_t index, const char* unlinked, ConstantValue& c)
+	{
+		if (isLinked(node, index))
+			return evaluate(node.inputs[index], c);
+		c = scalar(node.getValue(unlinked));
+		return true;
+	};
+	// elementwise with the same broadcasting as hlsl
+	auto apply = [](const ConstantValue& a, const ConstantValue& b, const ConstantValue& c, auto f)
+	{
+		ConstantValue r;
+		r.count = combineComponents({ a.count, b.count, c.count });
+		for (uint32_t i = 0; i < r.count; ++i)
+			r.value[i] = f(a.value[a.count == 1 ? 0 : i], b.value[b.count == 1 ? 0 : i], c.value[c.count == 1 ? 0 : i]);
+		return r;
+	};
+
+	// parameters are constants when their values are baked into the shader
+	ConstantValue a, b, c;
+	ConstantValue value;
+	const std::string& kind = node.kind;
+	const bool parameterBuffers = (mOptions & MO_ParameterBuffers) != 0;
+	if (kind == "Constant")
+		value = scalar(node.getValue("R"));
+	else if (parameterBuffers && (kind == "ScalarParameter" || kind == "VectorParameter"))
+		value.count = 0;
+	else if (kind == "ScalarParameter")
+		value = scalar(node.getValue("Value"));
+	else if (kind == "VectorParameter")
+	{
+		const float channels[4] = { node.getValue("R"), node.getValue("G"), node.getValue("B"), node.getValue("A") };
+		if (isChannel(link.output))
+			value = scalar(channels[link.output == "R" ? 0 : link.output == "G" ? 1 : link.output == "B" ? 2 : 3]);
+		else
+		{
+			value.count = 4;
+			memcpy(value.value, channels, sizeof(channels));
+		}
+	}
+	else if (kind == "Constant3Vector")
+	{
+		// same components as the handler emits
+		value.count = 4;
+		value.value[0] = node.getValue("R");
+		value.value[1] = node.getValue("G");
+		value.value[2] = node.getValue("B");
+		value.value[3] = node.getValue("B");
+	}
+	else if (kind == "Multiply")
+	{
+		if (operand(0, "ConstA", a) && operand(1, "ConstB", b))
+			value = apply(a, b, scalar(0), [](float x, float y, float) { return x * y; });
+	}
+	else if (kind == "Add")
+	{
+		if (operand(0, "ConstA", a) && operand(1, "ConstB", b))
+			value = apply(a, b, scalar(0), [](float x, float y, float) { return x + y; });
+	}
+	else if (kind == "Subtract")
+	{
+		if (operand(0, "ConstA", a) && operand(1, "ConstB", b))
+			value = apply(a, b, scalar(0), [](float x, float y, float) { return x - y; });
+	}
+	else if (kind == "Divide")
+	{
+		if (operand(0, "ConstA", a) && operand(1, "ConstB", b))
+			value = apply(a, b, scalar(0), [](float x, float y, float) { return x / y; });
+	}
+	else if (kind == "LinearInterpolate")
+	{
+		if (operand(0, "ConstA", a) && operand(1, "ConstB", b) && operand(2, "ConstAlpha", c))
+			value = apply(a, b, c, [](float x, float y, float s) { return x * (1 - s) + y * s; });
+	}
+	else if (kind == "Clamp")
+	{
+		if (linked(0, a) && operand(1, "MinDefault", b) && operand(2, "MaxDefault", c))
+			value = apply(a, b, c, [](float x, float lo, float hi) { return std::min(std::max(x, lo), hi); });
+	}
+	else if (kind == "OneMinus")
+	{
+		if (linked(0, a))
+			value = apply(a, scalar(0), scalar(0), [](float x, float, float) { return 1 - x; });
+	}
+	else if (kind == "Power")
+	{
+		if (linked(0, a) && operand(1, "ConstExponent", b))
+		{
+			// hlsl pow is exp2(y * log2(x)), nan for a negative base where std::pow is real for integral exponents.
+			// the nan leaves the expression to the shader
+			value = apply(a, b, scalar(0), [](float x, float y, float) { return x < 0 ? std::numeric_limits<float>::quiet_NaN() : std::pow(x, y); });
+		}
+	}
+	else if (kind == "ComponentMask")
+	{
+		const bool channels[4] = { node.getValue("R") != 0, node.getValue("G") != 0, node.getValue("B") != 0, node.getValue("A") != 0 };
+		if (linked(0, a))
+		{
+			value.count = 0;
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				if (!channels[i])
+					continue;
+				// hlsl only has .r on a scalar
+				if (i >= a.count && !(a.count == 1 && i == 0))
+				{
+					value.count = 0;
+					break;
+				}
+				value.value[value.count++] = a.value[i];
+			}
+		}
+	}
+
+	// nan and inf have no literal, the expression is left to the shader
+	for (uint32_t i = 0; i < value.count; ++i)
+	{
+		if (!std::isfinite(value.value[i]))
+			value.count = 0;
+	}
+
+	mConstants[key] = value;
+	result = value;
+	return value.count > 0;
+}
+
+void MaterialCompiler::parse(const MaterialLink& link, std::stringstream& ss)
+{
+	if (link.node < 0 || (size_t)link.node >= mGraph->nodes.size())
+	{
+		mErrors.push_back("missing input");
+		return;
+	}
+	const MaterialNode& node = mGraph->nodes[link.node];
+
+	auto& handlers = getHandlers();
+	auto handler = handlers.find(node.kind);
+	if (handler == handlers.end())
+	{
+		mErrors.push_back("cannot parse expression: " + node.name);
+		return;
+	}
+
+	ConstantValue constant;
+	if ((mOptions & MO_ConstantFolding) && evaluate(link, constant))
+	{
+		ss << "(" << toLiteral(constant) << ")";
+		return;
+	}
+
+	const OutputKey key(link.node, link.output);
+	auto temporary = mTemporaries.find(key);
+	if (temporary != mTemporaries.end())
+	{
+		ss << temporary->second;
+		return;
+	}
+
+	std::stringstream value;
+	value << "(";
+	handler->second(*this, node, link.output, value);
+	value << ")";
+	++mNumEvaluations;
+
+	// leaves are as cheap to repeat as a temporary, texture samples already have their own definition
+	static const std::set<std::string> leaves = {
+		"Constant", "Constant3Vector", "ScalarParameter", "VectorParameter", "TextureSample", "TextureCoordinate",
+		"VertexColor", "CameraVectorWS", "CameraPositionWS", "ObjectPositionWS", "ObjectRadius", "WorldPosition",
+		"Time", "Fresnel",
+	};
+	uint32_t components = 0;
+	if ((mOptions & MO_CommonSubexpressions) && mUses[key] > 1 && leaves.find(node.kind) == leaves.end())
+		components = getComponentCount(link);
+	if (components == 0)
+	{
+		ss << value.str();
+		return;
+	}
+
+	// float like the inlined expression would be evaluated, world position, time and tiled uv math lose too much in half
+	std::string variable = "_t" + std::to_string(mTemporaries.size());
+	mStatements.push_back((components == 1 ? std::string("float ") : "float" + std::to_string(components) + " ") + variable + " = " + value.str());
+	mTemporaries[key] = variable;
+	ss << variable;
+}
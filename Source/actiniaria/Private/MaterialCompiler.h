@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MaterialIR.h"
+
+// hlsl pixel shader generation from a MaterialGraph snapshot.
+// the expression handlers are one table shared by all compilers, a compiler only keeps the state of the graph it
+// compiles, so separate compilers can run on different threads.
+// no UE dependency, Tools builds it for the regression test on the checked in material graphs.
+class MaterialCompiler
+{
+public:
+	enum Option : uint32_t
+	{
+		// outputs read more than once are computed once into a temporary
+		MO_CommonSubexpressions = 1,
+		// outputs that do not depend on the pixel are emitted as literals, identities like x * 1 emit x
+		MO_ConstantFolding = 2,
+		// parameters are read from the MaterialParameters constant buffer instead of being baked in,
+		// the shader then is the same for every instance of a base material
+		MO_ParameterBuffers = 4,
+	};
+
+	explicit MaterialCompiler(uint32_t options): mOptions(options) {}
+
+	std::string compile(const MaterialGraph& graph);
+	// expression handlers run by the last compile, each temporary saves the handlers of its subgraph on every further read
+	uint32_t getNumEvaluations() const { return mNumEvaluations; }
+	// nodes the last compile could not translate, the shader is still complete but will not compile
+	const std::vector<std::string>& getErrors() const { return mErrors; }
+
+	// member of the MaterialParameters constant buffer
+	static std::string getParameterField(const std::string& name, bool vector);
+
+private:
+	// value of an output that does not depend on the pixel, count is the number of components
+	struct ConstantValue
+	{
+		uint32_t count = 0;
+		float value[4] = {};
+	};
+
+	typedef std::pair<int32_t, std::string> OutputKey;
+	typedef void (*Handler)(MaterialCompiler& compiler, const MaterialNode& node, const std::string& output, std::stringstream& ss);
+	static const std::map<std::string, Handler>& getHandlers();
+
+	void parse(const MaterialLink& link, std::stringstream& ss);
+	std::string parseToString(const MaterialLink& link);
+	static bool isLinked(const MaterialNode& node, size_t index);
+	void parseInput(const MaterialNode& node, size_t index, std::stringstream& ss);
+	void emitInput(const MaterialNode& node, size_t index, float unlinked, std::stringstream& ss);
+	bool evaluate(const MaterialLink& link, ConstantValue& result);
+	bool isConstantInput(const MaterialNode& node, size_t index, float unlinked, float value);
+	uint32_t getInputComponentCount(const MaterialNode& node, size_t index);
+	static std::string toLiteral(const ConstantValue& constant);
+	void countUses(const MaterialLink& link);
+	uint32_t getComponentCount(const MaterialLink& link);
+
+	uint32_t mOptions;
+	const MaterialGraph* mGraph = nullptr;
+	std::map<std::string, std::string> mBoundResources;
+	std::set<std::string> mDefinitions;
+	// definitions in the order they were emitted, every one only reads the ones before it
+	std::vector<std::string> mStatements;
+	std::map<OutputKey, uint32_t> mUses;
+	std::map<OutputKey, std::string> mTemporaries;
+	std::map<OutputKey, uint32_t> mComponents;
+	std::map<OutputKey, ConstantValue> mConstants;
+	std::vector<std::string> mErrors;
+	uint32_t mNumEvaluations = 0;
+	bool mReconstructNormals = false;
+};
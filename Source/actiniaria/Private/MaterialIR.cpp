@@ -0,0 +1,224 @@
+#include "MaterialIR.h"
+
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+// bump when a record changes its fields
+static const uint32_t MATERIAL_GRAPH_VERSION = 1;
+
+// names come from the editor and may hold anything, the separators are escaped
+static std::string escape(const std::string& str)
+{
+	std::string result;
+	result.reserve(str.size());
+	for (char c : str)
+	{
+		switch (c)
+		{
+		case '\\': result += "\\\\"; break;
+		case '\t': result += "\\t"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		default: result += c;
+		}
+	}
+	return result;
+}
+
+static std::string unescape(const std::string& str)
+{
+	std::string result;
+	result.reserve(str.size());
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		if (str[i] != '\\' || i + 1 == str.size())
+		{
+			result += str[i];
+			continue;
+		}
+		switch (str[++i])
+		{
+		case 't': result += '\t'; break;
+		case 'n': result += '\n'; break;
+		case 'r': result += '\r'; break;
+		default: result += str[i];
+		}
+	}
+	return result;
+}
+
+static std::string toString(float value)
+{
+	std::ostringstream ss;
+	ss.precision(std::numeric_limits<float>::max_digits10);
+	ss << value;
+	return ss.str();
+}
+
+static bool toFloat(const std::string& str, float& value)
+{
+	char* end = nullptr;
+	value = std::strtof(str.c_str(), &end);
+	return !str.empty() && *end == 0;
+}
+
+static bool toInt(const std::string& str, int32_t& value)
+{
+	char* end = nullptr;
+	long v = std::strtol(str.c_str(), &end, 10);
+	value = (int32_t)v;
+	return !str.empty() && *end == 0;
+}
+
+std::string sanitizeName(const std::string& name)
+{
+	// per byte like the regex it replaces, multibyte characters become one "_" per byte
+	std::string result = name;
+	for (char& c : result)
+	{
+		if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'))
+			c = '_';
+	}
+	return result;
+}
+
+std::string toVariableName(const std::string& name)
+{
+	return "_" + sanitizeName(name);
+}
+
+std::string writeMaterialGraph(const MaterialGraph& graph)
+{
+	std::ostringstream ss;
+	auto record = [&ss](std::initializer_list<std::string> fields)
+	{
+		bool first = true;
+		for (auto& f : fields)
+		{
+			ss << (first ? "" : "\t") << escape(f);
+			first = false;
+		}
+		ss << "\n";
+	};
+
+	record({ "materialgraph", std::to_string(MATERIAL_GRAPH_VERSION) });
+	record({ "roughness", toString(graph.roughness) });
+	record({ "metallic", toString(graph.metallic) });
+	for (auto& m : graph.macros)
+		record({ "macro", m });
+	for (auto& v : graph.vectorParameters)
+		record({ "vector", v });
+	for (auto& s : graph.scalarParameters)
+		record({ "scalar", s });
+	for (auto& slice : graph.textureSlices)
+		record({ "slice", slice.first, slice.second.array, std::to_string(slice.second.slice) });
+
+	// inputs, values and strings belong to the node record before them
+	for (auto& node : graph.nodes)
+	{
+		record({ "node", node.kind, node.name });
+		for (auto& input : node.inputs)
+			record({ "input", std::to_string(input.node), input.output });
+		for (auto& value : node.values)
+			record({ "value", value.first, toString(value.second) });
+		for (auto& str : node.strings)
+			record({ "string", str.first, str.second });
+	}
+	for (auto& output : graph.outputs)
+		record({ "output", output.name, std::to_string(output.components), std::to_string(output.link.node), output.link.output });
+	return ss.str();
+}
+
+bool readMaterialGraph(const std::string& text, MaterialGraph& graph)
+{
+	graph = MaterialGraph();
+	std::istringstream lines(text);
+	std::string line;
+	bool versioned = false;
+	while (std::getline(lines, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty())
+			continue;
+
+		std::vector<std::string> fields;
+		size_t begin = 0;
+		for (;;)
+		{
+			size_t end = line.find('\t', begin);
+			fields.push_back(unescape(line.substr(begin, end == std::string::npos ? std::string::npos : end - begin)));
+			if (end == std::string::npos)
+				break;
+			begin = end + 1;
+		}
+
+		const std::string& type = fields[0];
+		int32_t index = 0;
+		float value = 0;
+		if (type == "materialgraph")
+		{
+			if (fields.size() != 2 || !toInt(fields[1], index) || (uint32_t)index != MATERIAL_GRAPH_VERSION)
+				return false;
+			versioned = true;
+			continue;
+		}
+		// every graph starts with its version
+		if (!versioned)
+			return false;
+
+		if (type == "roughness" && fields.size() == 2 && toFloat(fields[1], value))
+			graph.roughness = value;
+		else if (type == "metallic" && fields.size() == 2 && toFloat(fields[1], value))
+			graph.metallic = value;
+		else if (type == "macro" && fields.size() == 2)
+			graph.macros.push_back(fields[1]);
+		else if (type == "vector" && fields.size() == 2)
+			graph.vectorParameters.push_back(fields[1]);
+		else if (type == "scalar" && fields.size() == 2)
+			graph.scalarParameters.push_back(fields[1]);
+		else if (type == "slice" && fields.size() == 4 && toInt(fields[3], index) && index >= 0)
+			graph.textureSlices[fields[1]] = { fields[2], (uint32_t)index };
+		else if (type == "node" && fields.size() == 3)
+		{
+			graph.nodes.emplace_back();
+			graph.nodes.back().kind = fields[1];
+			graph.nodes.back().name = fields[2];
+		}
+		else if (type == "input" && fields.size() == 3 && !graph.nodes.empty() && toInt(fields[1], index))
+			graph.nodes.back().inputs.push_back({ index, fields[2] });
+		else if (type == "value" && fields.size() == 3 && !graph.nodes.empty() && toFloat(fields[2], value))
+			graph.nodes.back().values[fields[1]] = value;
+		else if (type == "string" && fields.size() == 3 && !graph.nodes.empty())
+			graph.nodes.back().strings[fields[1]] = fields[2];
+		else if (type == "output" && fields.size() == 5 && toInt(fields[2], index) && index >= 1 && index <= 4)
+		{
+			MaterialOutput output;
+			output.name = fields[1];
+			output.components = (uint32_t)index;
+			if (!toInt(fields[3], output.link.node))
+				return false;
+			output.link.output = fields[4];
+			graph.outputs.push_back(std::move(output));
+		}
+		else
+			return false;
+	}
+
+	// links are checked once every node is known
+	for (auto& node : graph.nodes)
+	{
+		for (auto& input : node.inputs)
+		{
+			if (input.node < -1 || input.node >= (int32_t)graph.nodes.size())
+				return false;
+		}
+	}
+	for (auto& output : graph.outputs)
+	{
+		if (output.link.node < -1 || output.link.node >= (int32_t)graph.nodes.size())
+			return false;
+	}
+	return versioned;
+}
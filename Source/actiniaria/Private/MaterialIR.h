@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// material graph copied out of the UObjects on the game thread, MaterialCompiler only reads this and may run on any thread.
+// no UE dependency, graphs captured in the editor are compiled and measured by actiniaria_bench in Tools
+
+// output of another node feeding an input, node -1 when the input is not connected
+struct MaterialLink
+{
+	int32_t node = -1;
+	// output pin name, "R" "G" "B" "A" select a channel
+	std::string output;
+};
+
+struct MaterialNode
+{
+	// expression class without the MaterialExpression prefix, picks the handler
+	std::string kind;
+	// expression object name, unique in the graph
+	std::string name;
+	std::vector<MaterialLink> inputs;
+	// properties the handler reads, parameters already resolved for the material instance
+	std::map<std::string, float> values;
+	std::map<std::string, std::string> strings;
+
+	float getValue(const std::string& key, float fallback = 0.0f) const
+	{
+		auto ret = values.find(key);
+		return ret != values.end() ? ret->second : fallback;
+	}
+
+	const std::string& getString(const std::string& key) const
+	{
+		static const std::string empty;
+		auto ret = strings.find(key);
+		return ret != strings.end() ? ret->second : empty;
+	}
+};
+
+// connected material property like "Base Color", components is the width of the hlsl variable
+struct MaterialOutput
+{
+	std::string name;
+	uint32_t components = 1;
+	MaterialLink link;
+};
+
+// texture packed into a Texture2DArray, sampled with the slice as third uv component
+struct TextureSlice
+{
+	std::string array;
+	uint32_t slice = 0;
+};
+
+struct MaterialGraph
+{
+	std::vector<MaterialNode> nodes;
+	std::vector<MaterialOutput> outputs;
+	std::vector<std::string> macros;
+	// defaults of unconnected outputs
+	float roughness = 0.5f;
+	float metallic = 0.0f;
+	// fields of the MaterialParameters constant buffer in layout order
+	std::vector<std::string> vectorParameters;
+	std::vector<std::string> scalarParameters;
+	// keyed by texture object name, textures not in the map are bound as Texture2D
+	std::map<std::string, TextureSlice> textureSlices;
+};
+
+// "_" followed by name with everything but [0-9a-zA-Z_] replaced by "_", how textures are named in the shaders
+std::string toVariableName(const std::string& name);
+// name with everything but [0-9a-zA-Z_] replaced by "_"
+std::string sanitizeName(const std::string& name);
+
+// text form of a graph, one record per line with tab separated fields, for captured graph corpora.
+// floats round trip exactly, so a read graph compiles to the same hlsl as the captured one
+std::string writeMaterialGraph(const MaterialGraph& graph);
+// false on an unknown version or a malformed record, graph is then left partially filled
+bool readMaterialGraph(const std::string& text, MaterialGraph& graph);
@@ -1,4 +1,8 @@
 #include "MaterialParser.h"
+#include "MaterialCompiler.h"
+#include "NameTable.h"
+#include "ExportCache.h"
+#include "actiniaria.h"
 
 #include "Materials/Material.h"
 #include "Materials/MaterialInstance.h"
@@ -46,25 +50,18 @@
 #include "MaterialGraph/MaterialGraphNode_Root.h"
 
 #include "Editor.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+#include "UObject/UnrealType.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "Kismet2/BlueprintEditorUtils.h"
 
-#include <regex>
+#include <set>
 #include "Windows/MinWindows.h"
 
 
-static std::string format()
-{
-	return {};
-}
-
-template<class T, class ... Args>
-static std::string format(const T& v, Args&& ... args)
-{
-	std::stringstream ss;
-	ss << v << format(args...);
-	return ss.str();
-}
-
 static void Assert(bool v, const std::string& msg)
 {
 	if (!v)
@@ -73,731 +70,417 @@ static void Assert(bool v, const std::string& msg)
 	}
 }
 
-static std::string convertToMulti(const std::wstring& str)
-{
-	std::wstring_convert<std::codecvt<wchar_t, char, std::mbstate_t>>
-		converter(new std::codecvt<wchar_t, char, std::mbstate_t>("CHS"));
-	return converter.to_bytes(str);
-}
+static TAutoConsoleVariable<int32> CVarMaterialCSE(
+	TEXT("actiniaria.MaterialCSE"),
+	1,
+	TEXT("Compute material graph outputs read more than once into a temporary instead of inlining their subgraph at every use."));
+
+static TAutoConsoleVariable<int32> CVarMaterialConstantFolding(
+	TEXT("actiniaria.MaterialConstantFolding"),
+	1,
+	TEXT("Evaluate material subgraphs without per pixel inputs at translation time and drop identities like x * 1 and lerp with a constant alpha."));
+
+static TAutoConsoleVariable<int32> CVarMaterialParameterBuffers(
+	TEXT("actiniaria.MaterialParameterBuffers"),
+	1,
+	TEXT("Read material parameters from a per material constant buffer, instances of a base material then share one shader (1), or bake the values into each shader (0)."));
 
+typedef void (*Capture)(UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node);
 
-static std::string tostring(const FVector4& v)
+// properties each expression handler of MaterialCompiler reads, keyed by expression class.
+// expressions without an entry have no handler
+static const std::map<FString, Capture>& getCaptures()
 {
-	std::stringstream ss;
-	ss << "half4(" << v.X << "," << v.Y << "," << v.Z << "," << v.W << ")";
-	return ss.str();
+	static const std::map<FString, Capture> captures = {
+		{ TEXT("MaterialExpressionVectorParameter"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto vector = Cast<UMaterialExpressionVectorParameter>(expr);
+			FLinearColor value = vector->DefaultValue;
+			material->GetVectorParameterValue(FMaterialParameterInfo(vector->ParameterName), value);
+			node.strings["Parameter"] = NameTable::convert(*vector->ParameterName.ToString());
+			node.values["R"] = value.R;
+			node.values["G"] = value.G;
+			node.values["B"] = value.B;
+			node.values["A"] = value.A;
+		} },
+		{ TEXT("MaterialExpressionScalarParameter"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto scalar = Cast<UMaterialExpressionScalarParameter>(expr);
+			float value = scalar->DefaultValue;
+			material->GetScalarParameterValue(FMaterialParameterInfo(scalar->ParameterName), value);
+			node.strings["Parameter"] = NameTable::convert(*scalar->ParameterName.ToString());
+			node.values["Value"] = value;
+		} },
+		{ TEXT("MaterialExpressionLinearInterpolate"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto interpolate = Cast<UMaterialExpressionLinearInterpolate>(expr);
+			node.values["ConstA"] = interpolate->ConstA;
+			node.values["ConstB"] = interpolate->ConstB;
+			node.values["ConstAlpha"] = interpolate->ConstAlpha;
+		} },
+		{ TEXT("MaterialExpressionMultiply"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto mul = Cast<UMaterialExpressionMultiply>(expr);
+			node.values["ConstA"] = mul->ConstA;
+			node.values["ConstB"] = mul->ConstB;
+		} },
+		{ TEXT("MaterialExpressionAdd"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto add = Cast<UMaterialExpressionAdd>(expr);
+			node.values["ConstA"] = add->ConstA;
+			node.values["ConstB"] = add->ConstB;
+		} },
+		{ TEXT("MaterialExpressionSubtract"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto sub = Cast<UMaterialExpressionSubtract>(expr);
+			node.values["ConstA"] = sub->ConstA;
+			node.values["ConstB"] = sub->ConstB;
+		} },
+		{ TEXT("MaterialExpressionDivide"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto div = Cast<UMaterialExpressionDivide>(expr);
+			node.values["ConstA"] = div->ConstA;
+			node.values["ConstB"] = div->ConstB;
+		} },
+		{ TEXT("MaterialExpressionTextureSample"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto sampler = Cast<UMaterialExpressionTextureSample>(expr);
+			if (sampler->Texture)
+				node.strings["Texture"] = NameTable::convert(*sampler->Texture->GetName());
+			node.values["Normal"] = sampler->SamplerType == SAMPLERTYPE_Normal ? 1.0f : 0.0f;
+		} },
+		{ TEXT("MaterialExpressionConstant"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			node.values["R"] = Cast<UMaterialExpressionConstant>(expr)->R;
+		} },
+		{ TEXT("MaterialExpressionFresnel"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionConstant3Vector"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			const auto& var = Cast<UMaterialExpressionConstant3Vector>(expr)->Constant;
+			node.values["R"] = var.R;
+			node.values["G"] = var.G;
+			node.values["B"] = var.B;
+		} },
+		{ TEXT("MaterialExpressionTextureCoordinate"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto tc = Cast<UMaterialExpressionTextureCoordinate>(expr);
+			node.values["UTiling"] = tc->UTiling;
+			node.values["VTiling"] = tc->VTiling;
+		} },
+		{ TEXT("MaterialExpressionClamp"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto clamp = Cast<UMaterialExpressionClamp>(expr);
+			node.values["MinDefault"] = clamp->MinDefault;
+			node.values["MaxDefault"] = clamp->MaxDefault;
+		} },
+		{ TEXT("MaterialExpressionVertexColor"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionPanner"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto panner = Cast<UMaterialExpressionPanner>(expr);
+			node.values["SpeedX"] = panner->SpeedX;
+			node.values["SpeedY"] = panner->SpeedY;
+		} },
+		{ TEXT("MaterialExpressionComponentMask"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto mask = Cast<UMaterialExpressionComponentMask>(expr);
+			node.values["R"] = mask->R ? 1.0f : 0.0f;
+			node.values["G"] = mask->G ? 1.0f : 0.0f;
+			node.values["B"] = mask->B ? 1.0f : 0.0f;
+			node.values["A"] = mask->A ? 1.0f : 0.0f;
+		} },
+		{ TEXT("MaterialExpressionOneMinus"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionPower"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			node.values["ConstExponent"] = Cast<UMaterialExpressionPower>(expr)->ConstExponent;
+		} },
+		{ TEXT("MaterialExpressionSphereMask"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto sm = Cast<UMaterialExpressionSphereMask>(expr);
+			node.values["HardnessPercent"] = sm->HardnessPercent;
+			node.values["AttenuationRadius"] = sm->AttenuationRadius;
+		} },
+		{ TEXT("MaterialExpressionNormalize"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionCrossProduct"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionDotProduct"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionCameraVectorWS"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionCameraPositionWS"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionObjectPositionWS"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionObjectRadius"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionWorldPosition"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node) {} },
+		{ TEXT("MaterialExpressionTime"), [](UMaterialExpression* expr, UMaterialInterface* material, MaterialNode& node)
+		{
+			auto t = Cast<UMaterialExpressionTime>(expr);
+			node.values["OverridePeriod"] = t->bOverride_Period ? 1.0f : 0.0f;
+			node.values["Period"] = t->Period;
+		} },
+	};
+	return captures;
 }
 
-MaterialParser::MaterialParser()
+static MaterialLink snapshotLink(UEdGraphPin* pin, UMaterialInterface* material, MaterialGraph& graph, std::map<UEdGraphNode*, int32_t>& indices)
 {
-	mExprs["MaterialExpressionVectorParameter"] = [&, &overrides = mOverrideVectorParameters](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto vector = Cast<UMaterialExpressionVectorParameter>(expr);
-
-		auto defaultvalue = vector->DefaultValue;
-		auto ret = overrides.find(vector->ParameterName);
-		if (ret != overrides.end())
-		{
-			defaultvalue = ret->second->ParameterValue;
-		}
-
-		if (pin->PinName == "R")
-		{
-			ss << defaultvalue.R;
-		}
-		else if (pin->PinName == "G")
-		{ 
-			ss << defaultvalue.G;
-		}
-		else if (pin->PinName == "B")
-		{
-			ss << defaultvalue.B;
-		}
-		else if (pin->PinName == "A")
-		{
-			ss << defaultvalue.A;
-		}
-		else
-			ss <<  tostring(defaultvalue) ;
-	};
-
-	mExprs["MaterialExpressionLinearInterpolate"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto interpolate = Cast<UMaterialExpressionLinearInterpolate>(expr);
-		
-		ss << "lerp(";
-
-		// A
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << interpolate->ConstA ; 
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0],ss);
-		}
-		ss << ",";
-
-		// B
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << interpolate->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-		ss << ",";
-
-		if (inputs[2]->LinkedTo.Num() == 0)
-		{
-			ss << interpolate->ConstAlpha ;
-		}
-		else
-		{
-			parse(inputs[2]->LinkedTo[0], ss);
-		}
-		ss << ")";
-
-
-	};
-
-	mExprs["MaterialExpressionMultiply"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto mul = Cast<UMaterialExpressionMultiply>(expr);
-		
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << mul->ConstA;
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0], ss);
-		}
-
-		ss << " * ";
-
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << mul->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-
-
-	};
-
-	mExprs["MaterialExpressionAdd"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto add = Cast<UMaterialExpressionAdd>(expr);
-
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << add->ConstA;
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0], ss);
-		}
-
-		ss << " + ";
-
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << add->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-
-	};
-
-	mExprs["MaterialExpressionSubtract"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto sub = Cast<UMaterialExpressionSubtract>(expr);
-
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << sub->ConstA;
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0], ss);
-		}
-
-		ss << " - ";
-
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << sub->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-
-	};
+	MaterialLink link;
+	UMaterialGraphNode* graphnode = pin ? Cast<UMaterialGraphNode>(pin->GetOwningNode()) : nullptr;
+	if (graphnode == nullptr || graphnode->MaterialExpression == nullptr)
+		return link;
+	link.output = NameTable::convert(*pin->PinName.ToString());
 
-	mExprs["MaterialExpressionDivide"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
+	auto ret = indices.find(graphnode);
+	if (ret != indices.end())
 	{
-		auto div = Cast<UMaterialExpressionDivide>(expr);
-
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << div->ConstA;
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0], ss);
-		}
-
-		ss << " / ";
-
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << div->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-
-	};
-
-	
-
-	mExprs["MaterialExpressionScalarParameter"] = [&overrides = mOverrideScalarParameters](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto scalar = Cast<UMaterialExpressionScalarParameter>(expr);
-		auto defaultvalue = scalar->DefaultValue;
-		auto ret = overrides.find(scalar->ParameterName);
-		if (ret != overrides.end())
-		{
-			defaultvalue = ret->second->ParameterValue;
-		}
-		ss << defaultvalue;
-	};
-
-	mExprs["MaterialExpressionTextureSample"] = [&, &res = mBoundResources, &def = mDefinations](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto sampler = Cast<UMaterialExpressionTextureSample>(expr);
-		const auto& name = sampler->GetName();
-		const auto& texture = sampler->Texture->GetName();
-
-		auto toVariable = [](const std::string & str)
-		{
-			std::regex r("[^0-9a-zA-Z_]");
-			return "_" + std::regex_replace(str, r, "_");
-		};
-
-		// bind resource
-		if (res.find(texture) == res.end())
-		{
-			res[texture] = "Texture2D " + toVariable(convertToMulti(*texture));
-		}
-
-
-		// define variable and sample texture
-		if (def.find(name) == def.end())
-		{
-			std::string uv = "input.uv";
-			if (inputs[0]->LinkedTo.Num() != 0)
-			{
-				std::stringstream uvparser;
-				parse(inputs[0]->LinkedTo[0], uvparser);
-				uv = uvparser.str();
-			}
-
-			def[name] = "half4 " + convertToMulti(*name) + " = " + toVariable(convertToMulti(*texture)) + ".Sample(anisotropicSampler," + uv + ")";
-		}
-
-		ss << convertToMulti(*name);
-
-		if (pin->PinName == "R")
-		{
-			ss << ".r";
-		}
-		else if (pin->PinName == "G")
-		{
-			ss << ".g";
-		}
-		else if (pin->PinName == "B")
-		{
-			ss << ".b";
-		}
-		else if (pin->PinName == "A")
-		{
-			ss << ".a";
-		}
-		
-
-	};
-	mExprs["MaterialExpressionConstant"] = [](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto constant = Cast<UMaterialExpressionConstant>(expr);
+		link.node = ret->second;
+		return link;
+	}
+	// the index is taken before the inputs are walked, a cycle in a broken graph links back instead of recursing
+	link.node = (int32_t)graph.nodes.size();
+	indices.emplace(graphnode, link.node);
+	graph.nodes.emplace_back();
 
-		ss << constant->R;
-	};
-	mExprs["MaterialExpressionFresnel"] = [](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto fresnel= Cast<UMaterialExpressionFresnel>(expr);
+	auto expr = graphnode->MaterialExpression;
+	const FString name = expr->GetFName().GetPlainNameString();
+	MaterialNode node;
+	node.kind = NameTable::convert(*name.Replace(TEXT("MaterialExpression"), TEXT("")));
+	node.name = NameTable::convert(*expr->GetName());
+	auto& captures = getCaptures();
+	auto capture = captures.find(name);
+	if (capture != captures.end())
+		capture->second(expr, material, node);
+	else
+		Assert(false, "cannot parse expression: " + NameTable::convert(*expr->GetFName().ToString()));
 
-		ss << 0.5f;
-	};
-	mExprs["MaterialExpressionConstant3Vector"] = [](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto constant = Cast<UMaterialExpressionConstant3Vector>(expr);
-		const auto& var = constant->Constant;
-		ss << "half4(" << var.R << "," << var.G << "," << var.B << "," << var.B << ")";
-	};
+	TArray<UEdGraphPin*> inputs;
+	graphnode->GetInputPins(inputs);
+	for (auto input : inputs)
+		node.inputs.push_back(input->LinkedTo.Num() > 0 ? snapshotLink(input->LinkedTo[0], material, graph, indices) : MaterialLink());
 
+	// the nodes vector grew while the inputs were walked
+	graph.nodes[link.node] = std::move(node);
+	return link;
+}
 
-	mExprs["MaterialExpressionTextureCoordinate"] = [](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto tc = Cast<UMaterialExpressionTextureCoordinate>(expr);
-		ss << "input.uv";
-		if (tc->CoordinateIndex > 0)
-		{
-			//ss << tc->CoordinateIndex;
-		}
+MaterialGraph MaterialParser::snapshot(UMaterialInterface* material, std::map<std::string, TextureSlice> slices)
+{
+	MaterialGraph graph;
+	graph.textureSlices = std::move(slices);
 
-		ss << " * half2(" << tc->UTiling << "," << tc->VTiling<< ")";
-	};
-	mExprs["MaterialExpressionClamp"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto clamp = Cast<UMaterialExpressionClamp>(expr);
-		ss << "clamp(";
-		parse(inputs[0]->LinkedTo[0], ss);
-		ss << ", ";
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << clamp->MinDefault;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
-		ss << ", ";
-		if (inputs[2]->LinkedTo.Num() == 0)
-		{
-			ss << clamp->MaxDefault;
-		}
-		else
-		{
-			parse(inputs[2]->LinkedTo[0], ss);
-		}
+	auto base = material->GetBaseMaterial();
+	graph.roughness = base->Roughness.Constant;
+	graph.metallic = base->Metallic.Constant;
+	const ParameterLayout layout = getParameterLayout(base);
+	for (auto& v : layout.vectors)
+		graph.vectorParameters.push_back(NameTable::convert(*v.ToString()));
+	for (auto& s : layout.scalars)
+		graph.scalarParameters.push_back(NameTable::convert(*s.ToString()));
 
-		ss << ")";
-	};
-	mExprs["MaterialExpressionDivide"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
+	if (!base->MaterialGraph)
 	{
-		auto div = Cast<UMaterialExpressionDivide>(expr);
-		if (inputs[0]->LinkedTo.Num() == 0)
-		{
-			ss << div->ConstA;
-		}
-		else
-		{
-			parse(inputs[0]->LinkedTo[0], ss);
-		}
-		ss << "/";
-		if (inputs[1]->LinkedTo.Num() == 0)
-		{
-			ss << div->ConstB;
-		}
-		else
-		{
-			parse(inputs[1]->LinkedTo[0], ss);
-		}
+		base->MaterialGraph = CastChecked<UMaterialGraph>(FBlueprintEditorUtils::CreateNewGraph(base, NAME_None, UMaterialGraph::StaticClass(), UMaterialGraphSchema::StaticClass()));
+	}
+	base->MaterialGraph->Material = base;
+	base->MaterialGraph->MaterialFunction = nullptr;
+	base->MaterialGraph->OriginalMaterialFullName = base->GetName();
+	base->MaterialGraph->RebuildGraph();
 
-	};
-	mExprs["MaterialExpressionMaterialFunctionCall"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream&  ss)
-	{
-		auto fc = Cast<UMaterialExpressionMaterialFunctionCall>(expr);
-		Assert(0, "no impl");
-	};
-	mExprs["MaterialExpressionVertexColor"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto vc = Cast<UMaterialExpressionVertexColor>(expr);
-		ss << "input.color" ;
+	auto edgraph = base->MaterialGraph;
 
-		if (pin->PinName == "Output2")
-		{
-			ss << ".r";
-		}
-		else if (pin->PinName == "Output3")
-		{
-			ss << ".g";
-		}
-		else if (pin->PinName == "Output4")
-		{
-			ss << ".b";
-		}
-		else if (pin->PinName == "Output5")
-		{
-			ss << ".a";
-		}
-	};
-	mExprs["MaterialExpressionPanner"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
+	TArray<UEdGraphPin*> InputPins;
+	edgraph->RootNode->GetInputPins(InputPins);
+	std::map<UEdGraphNode*, int32_t> indices;
+	for (int32 Index = 0; Index < InputPins.Num(); ++Index)
 	{
-		auto panner = Cast<UMaterialExpressionPanner>(expr);
-		
-		std::string uv = "input.uv";
-		if (inputs[0]->LinkedTo.Num() != 0)
-		{
-			std::stringstream uvparser;
-			parse(inputs[0]->LinkedTo[0], uvparser);
-			uv = uvparser.str();
-		}
-
-		std::string time = "deltatime";
-		if (inputs[1]->LinkedTo.Num() != 0)
-		{
-			std::stringstream timeparser;
-			parse(inputs[1]->LinkedTo[0], timeparser);
-			time = timeparser.str();
-		}
+		if (!edgraph->MaterialInputs[Index].IsVisiblePin(edgraph->Material)
+			|| InputPins[Index]->LinkedTo.Num() == 0 || !InputPins[Index]->LinkedTo[0])
+			continue;
 
-		std::string speed = format("half2(", panner->SpeedX, ",",panner->SpeedY,")");
-		if (inputs[2]->LinkedTo.Num() != 0)
+		MaterialOutput output;
+		switch (edgraph->RootNode->GetInputType(InputPins[Index]))
 		{
-			std::stringstream parser;
-			parse(inputs[2]->LinkedTo[0], parser);
-			speed = parser.str();
+		case MCT_Float:
+		case MCT_Float1: output.components = 1; break;
+		case MCT_Float2: output.components = 2; break;
+		case MCT_Float3: output.components = 3; break;
+		case MCT_Float4: output.components = 4; break;
+		default:
+			Assert(false, "unsupported type");
+			continue;
 		}
+		if (edgraph->MaterialInputs[Index].GetProperty() == MP_Normal)
+			graph.macros.push_back("HAS_NORMALMAP");
 
-		ss << format(uv, " + ", speed, " * ", time);
-
-	};
+		output.name = NameTable::convert(*edgraph->MaterialInputs[Index].GetName().ToString());
+		output.link = snapshotLink(InputPins[Index]->LinkedTo[0], material, graph, indices);
+		graph.outputs.push_back(std::move(output));
+	}
+	return graph;
+}
 
-	mExprs["MaterialExpressionComponentMask"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto mask = Cast<UMaterialExpressionComponentMask>(expr);
+uint32 MaterialParser::getOptions()
+{
+	return (CVarMaterialCSE.GetValueOnAnyThread() != 0 ? MaterialCompiler::MO_CommonSubexpressions : 0) |
+		(CVarMaterialConstantFolding.GetValueOnAnyThread() != 0 ? MaterialCompiler::MO_ConstantFolding : 0) |
+		(CVarMaterialParameterBuffers.GetValueOnAnyThread() != 0 ? MaterialCompiler::MO_ParameterBuffers : 0);
+}
 
-		parse(inputs[0]->LinkedTo[0], ss);
+ParameterLayout MaterialParser::getParameterLayout(UMaterial* base)
+{
+	// every parameter node of the graph, also unconnected ones, so the layout is known without parsing
+	std::set<FString> vectors;
+	std::set<FString> scalars;
+	for (auto expr : base->Expressions)
+	{
+		if (auto vector = Cast<UMaterialExpressionVectorParameter>(expr))
+			vectors.insert(vector->ParameterName.ToString());
+		else if (auto scalar = Cast<UMaterialExpressionScalarParameter>(expr))
+			scalars.insert(scalar->ParameterName.ToString());
+	}
 
-		ss << ".";
+	ParameterLayout layout;
+	for (auto& v : vectors)
+		layout.vectors.push_back(FName(*v));
+	for (auto& s : scalars)
+		layout.scalars.push_back(FName(*s));
+	return layout;
+}
 
-		if (mask->R)
-			ss << "r";
-		if (mask->G)
-			ss << "g";
-		if (mask->B)
-			ss << "b";
-		if (mask->A)
-			ss << "a";
-	};
-	mExprs["MaterialExpressionOneMinus"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
+static void hashExpression(UMaterialExpression* expr, CacheKey& hash, std::map<UMaterialExpression*, uint32>& visited)
+{
+	// a node read again is hashed by the order it was first reached in, which keeps the hash of a DAG linear
+	auto ret = visited.find(expr);
+	if (ret != visited.end())
 	{
-		auto om = Cast<UMaterialExpressionOneMinus>(expr);
-		ss << "1 - ";
-		parse(inputs[0]->LinkedTo[0], ss);
-
-	};
+		hash << ret->second;
+		return;
+	}
+	visited.emplace(expr, (uint32)visited.size());
+	hash << expr->GetClass()->GetName();
 
-	mExprs["MaterialExpressionPower"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
+	// properties of the expression subclass, the base class only holds editor state.
+	// inputs are hashed below through the nodes they link to
+	static const std::set<FString> skipped = { TEXT("ExpressionGUID"), TEXT("Group"), TEXT("SortPriority"), TEXT("SliderMin"), TEXT("SliderMax") };
+	for (TFieldIterator<UProperty> it(expr->GetClass()); it; ++it)
 	{
-		auto power = Cast<UMaterialExpressionPower>(expr);
-		ss << "pow(";
-		parse(inputs[0]->LinkedTo[0], ss);
-
-		ss << ",";
-
-		if (inputs[1]->LinkedTo.Num() > 0)
-			parse(inputs[1]->LinkedTo[0], ss);
-		else
-			ss << power->ConstExponent;
-		
-		ss << ")";
-	};
-	mExprs["MaterialExpressionSphereMask"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto sm = Cast<UMaterialExpressionSphereMask>(expr);
-		
-		std::string hardness = format(sm->HardnessPercent *0.01f);
-		if (inputs[3]->LinkedTo.Num() > 0)
-		{
-			std::stringstream hp;
-			parse(inputs[3]->LinkedTo[0], hp);
-			hardness = hp.str() + " * 0.01f";
-		}
-
-		
-		std::string origin;
-		{
-			std::stringstream op;
-			parse(inputs[0]->LinkedTo[0], op);
-			origin = op.str();
-		}
-
-		std::string checkpoint;
-		{
-			std::stringstream cp;
-			parse(inputs[1]->LinkedTo[0], cp);
-			checkpoint = cp.str();
-		}
-
-
-
-		std::string radius = format(sm->AttenuationRadius);
-		if (inputs[2]->LinkedTo.Num() > 0)
+		UProperty* property = *it;
+		if (property->GetOwnerClass() == UMaterialExpression::StaticClass() || skipped.find(property->GetName()) != skipped.end())
+			continue;
+		if (auto structProperty = Cast<UStructProperty>(property))
 		{
-			std::stringstream rp;
-			parse(inputs[2]->LinkedTo[0], rp);
-			radius = rp.str();
+			if (structProperty->Struct->GetName().EndsWith(TEXT("ExpressionInput")))
+				continue;
 		}
-		if (hardness == "1" || hardness == "1.0")
+		for (int32 i = 0; i < property->ArrayDim; ++i)
 		{
-			ss <<  "1- floor(clamp(" <<format("length(", checkpoint, " - ", origin, ")/", radius) << ",0,1))";
+			FString value;
+			property->ExportTextItem(value, property->ContainerPtrToValuePtr<void>(expr, i), nullptr, expr, PPF_None);
+			hash << property->GetName() << value;
 		}
-		else
-		{
-			ss << "clamp("<< hardness << "1 / (1 - " << hardness << ") * (1.0f - clamp(";
-			ss << format("length(", checkpoint, " - ", origin, ")/", radius) << ",0,1.0f))" << ",0,1.0f)";
-		}
-
-
-	};
-	mExprs["MaterialExpressionNormalize"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto n = Cast<UMaterialExpressionNormalize>(expr);
-
-		ss << "normalize(";
-		parse(inputs[0]->LinkedTo[0], ss);
-		ss << ".xyz)";
-	};
-	mExprs["MaterialExpressionCrossProduct"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto c = Cast<UMaterialExpressionCrossProduct>(expr);
-
-		ss << "cross(";
-		parse(inputs[0]->LinkedTo[0], ss);
-		ss <<".xyz,";
-		parse(inputs[1]->LinkedTo[0], ss);
-		ss << ".xyz)";
-	};
-
-	mExprs["MaterialExpressionDotProduct"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		auto d = Cast<UMaterialExpressionDotProduct>(expr);
-
-		ss << "dot(";
-		parse(inputs[0]->LinkedTo[0], ss);
-		ss << ".xyz,";
-		parse(inputs[1]->LinkedTo[0], ss);
-		ss << ".xyz)";
-	};
-	mExprs["MaterialExpressionCameraVectorWS"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		//auto d = Cast<UMaterialExpressionCameraVectorWS>(expr);
-
-		ss << "V";
-	};
-	mExprs["MaterialExpressionCameraPositionWS"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		//auto d = Cast<MaterialExpressionCameraPositionWS>(expr);
-
-		ss << "campos";
-	};
-	mExprs["MaterialExpressionObjectPositionWS"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		ss << "objpos";
-	};
-
-	mExprs["MaterialExpressionObjectRadius"] = [&](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		ss << "objradius";
-	};
+	}
 
-	mExprs["MaterialExpressionWorldPosition"] = [&, &def = mDefinations](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
-	{
-		ss << "input.worldPos.xyz";
-	};
-	mExprs["MaterialExpressionTime"] = [&, &def = mDefinations](const TArray<UEdGraphPin*>& inputs, const TArray<UEdGraphPin*>& outputs, UMaterialExpression* expr, UEdGraphPin* pin, std::stringstream& ss)
+	for (FExpressionInput* input : expr->GetInputs())
 	{
-		auto t = Cast<UMaterialExpressionTime>(expr);
-		if (t->bOverride_Period)
-			ss << "fmod(time, "  << t->Period << ")";
-		else
-			ss << "time";
-	};
+		hash << (input->Expression != nullptr);
+		if (input->Expression == nullptr)
+			continue;
+		hash << input->OutputIndex << input->Mask << input->MaskR << input->MaskG << input->MaskB << input->MaskA;
+		hashExpression(input->Expression, hash, visited);
+	}
 }
 
-std::string MaterialParser::operator()(UMaterialInterface* material)
+void MaterialParser::hashGraph(UMaterial* base, CacheKey& hash)
 {
-	mBoundResources.clear();
-	mDefinations.clear();
-	mOverrideVectorParameters.clear();
-	mOverrideScalarParameters.clear();
-	mMacros.clear();
-	auto instance = Cast<UMaterialInstance>(material);
-	if (instance)
-	{
-		for (auto& vp : instance->VectorParameterValues)
-		{
-			mOverrideVectorParameters[vp.ParameterInfo.Name] = &vp;
-		}
-
-		for (auto& vp : instance->ScalarParameterValues)
-		{
-			mOverrideScalarParameters[vp.ParameterInfo.Name] = &vp;
-		}
+	std::map<UMaterialExpression*, uint32> visited;
+	for (int32 p = 0; p < MP_MAX; ++p)
+	{
+		FExpressionInput* input = base->GetExpressionInputForProperty((EMaterialProperty)p);
+		if (input == nullptr || input->Expression == nullptr)
+			continue;
+		hash << p << input->OutputIndex << input->Mask << input->MaskR << input->MaskG << input->MaskB << input->MaskA;
+		hashExpression(input->Expression, hash, visited);
 	}
+	// defaults of unconnected outputs
+	hash << base->Roughness.Constant << base->Metallic.Constant;
+}
 
-	auto base = material->GetBaseMaterial();
-	if (!base->MaterialGraph)
-	{
-		base->MaterialGraph = CastChecked<UMaterialGraph>(FBlueprintEditorUtils::CreateNewGraph(base, NAME_None, UMaterialGraph::StaticClass(), UMaterialGraphSchema::StaticClass()));
+std::vector<float> MaterialParser::packParameters(UMaterialInterface* material, const ParameterLayout& layout)
+{
+	std::vector<float> values(layout.getSize() / sizeof(float), 0.0f);
+	for (size_t i = 0; i < layout.vectors.size(); ++i)
+	{
+		FLinearColor color(0, 0, 0, 0);
+		material->GetVectorParameterValue(FMaterialParameterInfo(layout.vectors[i]), color);
+		values[i * 4 + 0] = color.R;
+		values[i * 4 + 1] = color.G;
+		values[i * 4 + 2] = color.B;
+		values[i * 4 + 3] = color.A;
 	}
-	base->MaterialGraph->Material = base;
-	base->MaterialGraph->MaterialFunction = nullptr;
-	base->MaterialGraph->OriginalMaterialFullName = base->GetName();
-	base->MaterialGraph->RebuildGraph();
-	//base->MaterialGraph->RealtimeDelegate.BindSP(this, &FMaterialEditor::IsToggleRealTimeExpressionsChecked);
-	//base->MaterialGraph->MaterialDirtyDelegate.BindSP(this, &FMaterialEditor::SetMaterialDirty);
-	//base->MaterialGraph->ToggleCollapsedDelegate.BindSP(this, &FMaterialEditor::ToggleCollapsed);
-
-	auto graph = base->MaterialGraph;
-	
-	TArray<UEdGraphPin*> InputPins;
-	graph->RootNode->GetInputPins(InputPins);
-	TArray<UEdGraphNode*> NodesToCheck;
-
-	std::stringstream ss;
-
-	struct Requirement
-	{
-		bool exist = false;
-		std::string type ;
-		std::string value;
-	};
-	std::map<FString, Requirement> required;
-	
-	required["Base Color"] = { false, "half3", "0.0f" };
-	required["Roughness"] = {false, "half", format(base->Roughness.Constant)};
-	required["Metallic"] = { false, "half", format(base->Metallic.Constant) };
-	required["Emissive Color"] = { false, "half3", "0.0f" };
+	for (size_t i = 0; i < layout.scalars.size(); ++i)
+		material->GetScalarParameterValue(FMaterialParameterInfo(layout.scalars[i]), values[layout.vectors.size() * 4 + i]);
+	return values;
+}
 
 
-	for (int32 Index = 0; Index < InputPins.Num(); ++Index)
-	{
-		if (graph->MaterialInputs[Index].IsVisiblePin(graph->Material)
-			&& InputPins[Index]->LinkedTo.Num() > 0 && InputPins[Index]->LinkedTo[0])
-		{
-			auto type = graph->RootNode->GetInputType(InputPins[Index]);
-			auto semantic = graph->MaterialInputs[Index].GetProperty();
-			switch (semantic)
-			{
-			case MP_Normal: mMacros[L"HAS_NORMALMAP"] = "HAS_NORMALMAP";break;
-			}
-
-			FString var = "	";
-			FString trailer ;
-			switch (type)
-			{
-			case MCT_Float:
-			case MCT_Float1: var += "half ";break;
-			case MCT_Float2: var += "half2 "; trailer = ".rg"; break;
-			case MCT_Float3: var += "half3 "; trailer = ".rgb"; break;
-			case MCT_Float4: var += "half4 "; trailer = ".rgba"; break;
-			default: 
-				Assert(false, "unsupported type");
-			}
-
-			auto name = graph->MaterialInputs[Index].GetName().ToString();
-			var += name.Replace(L" ", L"_");
-
-			if (required.find(name) != required.end())
-			{
-				required[name].exist = true;
-			}
-
-			ss << convertToMulti(*var) << " = ";
-			parse(InputPins[Index]->LinkedTo[0], ss);
-			ss <<  ";\n";
-		}
-	}
-
-	for (auto& r : required)
-	{
-		if (!r.second.exist)
-		{
-			ss << "	" << r.second.type << " " << convertToMulti(*r.first.Replace(L" ", L"_")) << " = " << r.second.value << ";\n";
-		}
+static void compareMaterialTranslation()
+{
+	// every loaded material translated without and with the optimizations enabled by the console variables,
+	// handler runs stand in for the emitted alu
+	uint64 totalBefore = 0;
+	uint64 totalAfter = 0;
+	for (TObjectIterator<UMaterial> iter; iter; ++iter)
+	{
+		UMaterial* material = *iter;
+		const MaterialGraph graph = MaterialParser::snapshot(material);
+		MaterialCompiler baseline(0);
+		std::string before = baseline.compile(graph);
+		MaterialCompiler optimized(MaterialParser::getOptions());
+		std::string after = optimized.compile(graph);
+
+		totalBefore += baseline.getNumEvaluations();
+		totalAfter += optimized.getNumEvaluations();
+		if (baseline.getNumEvaluations() != optimized.getNumEvaluations() || before.size() != after.size())
+			UE_LOG(LogActiniaria, Display, TEXT("%s: %u -> %u expressions, %llu -> %llu bytes"), *material->GetName(),
+				baseline.getNumEvaluations(), optimized.getNumEvaluations(), (uint64)before.size(), (uint64)after.size());
 	}
+	UE_LOG(LogActiniaria, Display, TEXT("material translation: %llu -> %llu expressions"), totalBefore, totalAfter);
+}
 
-	std::string shader;
-	//shader += "#ifndef __SHADER_CONTENT__\n";
-	//shader += "#error need shader content\n";
-	//shader += "#endif\n";
-	for (auto& m: mMacros)
-		shader += "#define " + m.second + "\n";
-	std::vector<std::string> headers = {
-		"common.hlsl",
-		"pbr.hlsl",
-	};
-	for (auto& h: headers)
-		shader += std::string("#include ") + "\"" + h + "\"\n";
-
-	
-	for (auto& r: mBoundResources)
-		shader += r.second + ";\n";
-
-	shader += "__BOUND_RESOURCE__  \n";
-
-	shader += "sampler pointSampler:register(s0);\n";
-	shader += "sampler linearSampler:register(s1);\n";
-	shader += "sampler linearClamp:register(s2);\n";
-	shader += "sampler anisotropicSampler:register(s3);\n";
-
-	shader += "half4 ps(PSInput input):SV_TARGET \n{\n";
-	shader += "	half3 V = normalize(campos.xyz - input.worldPos.xyz);\n";
-
-	for(auto& d: mDefinations)
-		shader += "	" + d.second + ";\n";
-
-	shader+= ss.str();
-
-
-	shader += "#ifdef HAS_NORMALMAP\n";
-	shader += "	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);\n";
-	shader += "#else\n";
-	shader += "	half3 _normal = input.normal.xyz;\n";
-	shader += "#endif\n";
-	//shader += "	half3 _final = directBRDF(Roughness, Metallic, F0_DEFAULT, Base_Color.rgb, _normal.xyz,-sundir, campos - input.worldPos);\n";
-	//shader += "	return half4(_final ,1) * suncolor;\n";
-	//shader += "	return half4(_normal * 0.5 + 0.5,1);";
+static FAutoConsoleCommand CompareMaterialTranslationCommand(
+	TEXT("actiniaria.CompareMaterialTranslation"),
+	TEXT("Translates every loaded material without and with common subexpression elimination and constant folding and logs the emitted expression counts and shader sizes."),
+	FConsoleCommandDelegate::CreateStatic(&compareMaterialTranslation));
 
-	shader += "	__SHADER_CONTENT__";
-	shader += "\n\n}\n\n";
-	return shader;
+static FString getGraphCorpusDirectory(const TArray<FString>& args)
+{
+	return args.Num() > 0 ? args[0] : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("actiniaria"), TEXT("MaterialGraphs"));
 }
 
-void MaterialParser::parse(UEdGraphPin * pin, std::stringstream & ss)
+static bool saveString(const std::string& text, const FString& path)
 {
-	
-	UMaterialGraphNode* graphnode = Cast<UMaterialGraphNode>(pin->GetOwningNode());
-	TArray<UEdGraphPin*> inputs;
-	graphnode->GetInputPins(inputs);
-
-	TArray<UEdGraphPin*> outputs;
-	graphnode->GetOutputPins(outputs);
-
+	return FFileHelper::SaveArrayToFile(TArrayView<const uint8>((const uint8*)text.data(), (int32)text.size()), *path);
+}
 
-	auto expr = graphnode->MaterialExpression;
-	auto name = expr->GetFName();
-	
-	auto cal = mExprs[name.GetPlainNameString()];
-	if (cal)
-	{
-		ss << "(";
-		cal(inputs, outputs, expr,pin, ss);
-		ss << ")";
+static void captureMaterialGraphs(const TArray<FString>& args)
+{
+	// every loaded material and instance as a graph file, next to the shader the current options generate from it.
+	// the shader file is named after the options so the benchmark in Tools only compares output generated the same way
+	const FString directory = getGraphCorpusDirectory(args);
+	IFileManager::Get().MakeDirectory(*directory, true);
+	const uint32 options = MaterialParser::getOptions();
+	uint32 count = 0;
+	for (TObjectIterator<UMaterialInterface> iter; iter; ++iter)
+	{
+		UMaterialInterface* material = *iter;
+		if (material->GetBaseMaterial() == nullptr)
+			continue;
+		const MaterialGraph graph = MaterialParser::snapshot(material);
+		MaterialCompiler compiler(options);
+		const FString path = FPaths::Combine(directory, FPaths::MakeValidFileName(material->GetPathName().Replace(TEXT("/"), TEXT("_")), TEXT('_')));
+		if (saveString(writeMaterialGraph(graph), path + TEXT(".graph")) &&
+			saveString(compiler.compile(graph), path + FString::Printf(TEXT(".%u.hlsl"), options)))
+			++count;
 	}
-	else
-		Assert(false, "cannot parse expression: " + (convertToMulti(*name.ToString())));
-
+	UE_LOG(LogActiniaria, Display, TEXT("captured %u material graphs to %s"), count, *directory);
 }
+
+static FAutoConsoleCommand CaptureMaterialGraphsCommand(
+	TEXT("actiniaria.CaptureMaterialGraphs"),
+	TEXT("Writes the graph of every loaded material and the shader generated from it for actiniaria_bench materialcompiler in Tools. Usage: actiniaria.CaptureMaterialGraphs [Directory]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&captureMaterialGraphs));
@@ -3,26 +3,37 @@
 #include "Core.h"
 
 #include <map>
-#include <functional>
+#include <vector>
 #include "Materials/MaterialInterface.h"
 #include "Materials/MaterialInstance.h"
 
-#include <sstream>
+#include "MaterialIR.h"
 
-class MaterialParser
+// fields of the MaterialParameters constant buffer. vectors come first, then the scalars packed four to a register,
+// both sorted by name so the layout only depends on the base material
+struct ParameterLayout
 {
-public:
-	MaterialParser();
-	std::string operator()(UMaterialInterface* material);
+	std::vector<FName> vectors;
+	std::vector<FName> scalars;
 
-private:
-	void parse(UEdGraphPin* pin, std::stringstream& ss);
+	uint32 getSize() const { return (uint32)(vectors.size() * 16 + (scalars.size() + 3) / 4 * 16); }
+};
 
-	std::map<FString, std::function<void(const TArray<UEdGraphPin*>&, const TArray<UEdGraphPin*>&, UMaterialExpression*, UEdGraphPin* pin,std::stringstream& )>> mExprs;
-	std::map<FString, std::string> mBoundResources;
-	std::map<FString,std::string> mDefinations;
-	std::map<FString, std::string> mMacros;
-	std::map<FName, FVectorParameterValue*> mOverrideVectorParameters;
-	std::map<FName, FScalarParameterValue*> mOverrideScalarParameters;
+// everything of a material the shader generation needs from the UObjects, game thread only.
+// MaterialCompiler turns the snapshot into hlsl on any thread
+class MaterialParser
+{
+public:
+	// the graph reachable from the material outputs with parameters resolved for the instance.
+	// slices are keyed by texture object name, textures not in the map are bound as Texture2D
+	static MaterialGraph snapshot(UMaterialInterface* material, std::map<std::string, TextureSlice> slices = {});
+	// MaterialCompiler::Option flags from the console variables, part of the shader cache key
+	static uint32 getOptions();
 
-};
\ No newline at end of file
+	static ParameterLayout getParameterLayout(UMaterial* base);
+	// everything of the base material graph the generated shader depends on, without object names, node positions
+	// or guids, so materials with identical graphs hash the same
+	static void hashGraph(UMaterial* base, class CacheKey& hash);
+	// constant buffer content of a material or instance, parent instances and defaults fill what it does not override
+	static std::vector<float> packParameters(UMaterialInterface* material, const ParameterLayout& layout);
+};
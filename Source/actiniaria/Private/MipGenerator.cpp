@@ -0,0 +1,205 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ACTINIARIA_SSE 1
+#include <emmintrin.h>
+#else
+#define ACTINIARIA_SSE 0
+#endif
+
+namespace
+{
+	// 8 bit srgb to linear and back, the inverse table is fine enough to round trip every 8 bit value
+	struct SRGBTables
+	{
+		float toLinear[256];
+		uint8_t fromLinear[65536];
+
+		SRGBTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float s = i / 255.0f;
+				toLinear[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 65536; ++i)
+			{
+				float l = i / 65535.0f;
+				float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = (uint8_t)std::min(std::max((int)(s * 255.0f + 0.5f), 0), 255);
+			}
+		}
+
+		static const SRGBTables& get()
+		{
+			static const SRGBTables tables;
+			return tables;
+		}
+	};
+}
+
+uint32_t MipGenerator::getBytesPerPixel(PixelFormat format)
+{
+	switch (format)
+	{
+	case PF_R8: return 1;
+	case PF_R16: return 2;
+	case PF_BGRA8: return 4;
+	case PF_RGBA16: return 8;
+	case PF_RGBA16F: return 8;
+	default: return 0;
+	}
+}
+
+uint32_t MipGenerator::getNumMips(uint32_t width, uint32_t height)
+{
+	uint32_t size = std::max(width, height);
+	uint32_t count = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		++count;
+	}
+	return count;
+}
+
+float MipGenerator::halfToFloat(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		// zero or denormal, mantissa * 2^-24
+		float f = mantissa * (1.0f / 16777216.0f);
+		return sign ? -f : f;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+uint16_t MipGenerator::floatToHalf(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t abs = bits & 0x7fffffff;
+
+	if (abs >= 0x7f800000)
+		return sign | (abs > 0x7f800000 ? 0x7e00 : 0x7c00);
+	// 65520 and above round to infinity
+	if (abs >= 0x477ff000)
+		return sign | 0x7c00;
+	if (abs < 0x38800000)
+	{
+		float a;
+		memcpy(&a, &abs, sizeof(a));
+		return sign | (uint16_t)std::nearbyint(a * 16777216.0f);
+	}
+
+	// rebias the exponent and round the mantissa to nearest even
+	uint32_t rounded = abs + 0xc8000fff + ((abs >> 13) & 1);
+	return sign | (uint16_t)(rounded >> 13);
+}
+
+void MipGenerator::filterPixel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* dst) const
+{
+	uint32_t bpp = getBytesPerPixel(mFormat);
+	const uint8_t* p[4] = { row0 + x0 * bpp, row0 + x1 * bpp, row1 + x0 * bpp, row1 + x1 * bpp };
+
+	switch (mFormat)
+	{
+	case PF_R8:
+	case PF_BGRA8:
+	{
+		const SRGBTables& tables = SRGBTables::get();
+		for (uint32_t c = 0; c < bpp; ++c)
+		{
+			if (mSRGB && c < 3)
+			{
+				float l = (tables.toLinear[p[0][c]] + tables.toLinear[p[1][c]] + tables.toLinear[p[2][c]] + tables.toLinear[p[3][c]]) * 0.25f;
+				dst[c] = tables.fromLinear[(int)(l * 65535.0f + 0.5f)];
+			}
+			else
+				dst[c] = (uint8_t)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) >> 2);
+		}
+		break;
+	}
+	case PF_R16:
+	case PF_RGBA16:
+	{
+		for (uint32_t c = 0; c < bpp / 2; ++c)
+		{
+			uint32_t sum = 2;
+			for (int i = 0; i < 4; ++i)
+				sum += ((const uint16_t*)p[i])[c];
+			((uint16_t*)dst)[c] = (uint16_t)(sum >> 2);
+		}
+		break;
+	}
+	case PF_RGBA16F:
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			float sum = 0;
+			for (int i = 0; i < 4; ++i)
+				sum += halfToFloat(((const uint16_t*)p[i])[c]);
+			((uint16_t*)dst)[c] = floatToHalf(sum * 0.25f);
+		}
+		break;
+	}
+	}
+}
+
+uint32_t MipGenerator::filterRowSSE(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t dstWidth, uint8_t* dst) const
+{
+	uint32_t x = 0;
+#if ACTINIARIA_SSE
+	// linear BGRA8, two output pixels from 16 bytes of each source row
+	if (mFormat != PF_BGRA8 || mSRGB)
+		return 0;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+	for (; x + 2 <= dstWidth && 2 * x + 4 <= width; x += 2)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+		__m128i left = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		__m128i right = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+		__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(left, right), two), 2);
+		_mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(sum, zero));
+	}
+#endif
+	return x;
+}
+
+void MipGenerator::downsample(const uint8_t* src, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t numRows, uint8_t* dst, bool simd) const
+{
+	uint32_t bpp = getBytesPerPixel(mFormat);
+	uint32_t dstWidth = getMipSize(width, 1);
+	uint32_t lastRow = std::min(firstRow + numRows, getMipSize(height, 1));
+	for (uint32_t y = firstRow; y < lastRow; ++y)
+	{
+		const uint8_t* row0 = src + (size_t)std::min(y * 2, height - 1) * width * bpp;
+		const uint8_t* row1 = src + (size_t)std::min(y * 2 + 1, height - 1) * width * bpp;
+		uint8_t* out = dst + (size_t)(y - firstRow) * dstWidth * bpp;
+
+		uint32_t x = simd ? filterRowSSE(row0, row1, width, dstWidth, out) : 0;
+		for (; x < dstWidth; ++x)
+			filterPixel(row0, row1, std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1), out + x * bpp);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// cpu mip generation for textures whose source has no mip chain.
+// every output row only reads two source rows, so callers can split a mip into row ranges and filter them in parallel.
+// no UE dependency, Tools/Tests compares the simd and scalar filters on every format.
+class MipGenerator
+{
+public:
+	enum PixelFormat : uint32_t
+	{
+		PF_R8,
+		PF_R16,
+		PF_BGRA8,
+		PF_RGBA16,
+		PF_RGBA16F,
+	};
+
+	// srgb color channels are averaged in linear space, alpha always is linear
+	MipGenerator(PixelFormat format, bool srgb) : mFormat(format), mSRGB(srgb) {}
+
+	// 2x2 box filter of the width x height image src, writes rows [firstRow, firstRow + numRows) of the next mip.
+	// dst points at row firstRow, odd sizes repeat the last source row or column
+	void downsample(const uint8_t* src, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t numRows, uint8_t* dst, bool simd = true) const;
+
+	static uint32_t getBytesPerPixel(PixelFormat format);
+	static uint32_t getMipSize(uint32_t size, uint32_t level) { return std::max(size >> level, 1u); }
+	// levels down to 1x1
+	static uint32_t getNumMips(uint32_t width, uint32_t height);
+
+	static float halfToFloat(uint16_t h);
+	static uint16_t floatToHalf(float f);
+private:
+	void filterPixel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* dst) const;
+	uint32_t filterRowSSE(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t dstWidth, uint8_t* dst) const;
+private:
+	PixelFormat mFormat;
+	bool mSRGB;
+};
@@ -0,0 +1,51 @@
+#include "NameTable.h"
+#include "MaterialIR.h"
+
+#include <codecvt>
+#include <locale>
+
+std::string NameTable::convert(const TCHAR* str)
+{
+	// constructing the converter and its locale facet costs more than converting a name
+	static thread_local std::wstring_convert<std::codecvt<wchar_t, char, std::mbstate_t>>
+		converter(new std::codecvt<wchar_t, char, std::mbstate_t>("CHS"));
+	return converter.to_bytes(str);
+}
+
+NameTable::Id NameTable::add(const TCHAR* str)
+{
+	mNames.push_back(convert(str));
+	mVariables.push_back(INDEX_NONE);
+	return (Id)(mNames.size() - 1);
+}
+
+NameTable::Id NameTable::intern(FName name)
+{
+	if (const Id* id = mNameIds.Find(name))
+		return *id;
+	const Id id = add(*name.ToString());
+	mNameIds.Add(name, id);
+	return id;
+}
+
+NameTable::Id NameTable::intern(const FString& name)
+{
+	if (const Id* id = mStringIds.Find(name))
+		return *id;
+	const Id id = add(*name);
+	mStringIds.Add(name, id);
+	return id;
+}
+
+const std::string& NameTable::getVariable(Id id)
+{
+	if (mVariables[id] == INDEX_NONE)
+	{
+		// stored as a name of its own, the vectors may grow and move the strings
+		const std::string variable = toVariableName(mNames[id]);
+		mNames.push_back(variable);
+		mVariables.push_back(INDEX_NONE);
+		mVariables[id] = (int32)(mNames.size() - 1);
+	}
+	return mNames[mVariables[id]];
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Core.h"
+
+#include <string>
+#include <vector>
+
+// names sent to the render station, converted to the multibyte encoding the receiver reads once per distinct name
+// and referenced by id afterwards. filled on the game thread, ids stay valid for the lifetime of the table
+class NameTable
+{
+public:
+	typedef uint32 Id;
+
+	// object names are keyed by FName, a repeated name is a hash lookup without conversion or allocation
+	Id intern(FName name);
+	// composed names that have no FName
+	Id intern(const FString& name);
+
+	const std::string& get(Id id) const { return mNames[id]; }
+	const std::string& get(FName name) { return get(intern(name)); }
+	// "_" followed by the name with everything but [0-9a-zA-Z_] replaced, as bound in the generated shaders
+	const std::string& getVariable(Id id);
+	uint32 getNum() const { return (uint32)mNames.size(); }
+
+	// conversion of names that are not interned, the converter is created once per thread
+	static std::string convert(const TCHAR* str);
+private:
+	Id add(const TCHAR* str);
+
+	std::vector<std::string> mNames;
+	// id of the variable form, INDEX_NONE until it is first asked for
+	std::vector<int32> mVariables;
+	TMap<FName, Id> mNameIds;
+	TMap<FString, Id> mStringIds;
+};
@@ -0,0 +1,135 @@
+#include "PayloadCompressor.h"
+
+#include "Misc/Compression.h"
+#include "Async/ParallelFor.h"
+
+#include <algorithm>
+
+static FName getFormatName(PayloadCodec codec)
+{
+	return codec == PC_LZ4 ? NAME_LZ4 : NAME_Zlib;
+}
+
+// lz4 is used for speed, zlib trades time for ratio
+static ECompressionFlags getFlags(PayloadCodec codec)
+{
+	return codec == PC_LZ4 ? COMPRESS_BiasSpeed : COMPRESS_BiasMemory;
+}
+
+PayloadCompressor::PayloadCompressor(PayloadCodec codec, uint32 chunkSize, uint32 minSize):
+	mCodec(codec), mChunkSize(FMath::Max(chunkSize, 1U)), mMinSize(minSize)
+{
+}
+
+uint32 PayloadCompressor::getSupportedCodecs()
+{
+	return (1U << PC_None) | (1U << PC_LZ4) | (1U << PC_Zlib);
+}
+
+void PayloadCompressor::compress(const void* data, uint32 size, std::vector<char>& out, bool parallel) const
+{
+	const bool store = mCodec == PC_None || size < mMinSize;
+	const uint32 chunkSize = store ? FMath::Max(size, 1U) : mChunkSize;
+	const uint32 numChunks = (size + chunkSize - 1) / chunkSize;
+
+	PayloadHeader header = { size, chunkSize, numChunks };
+	const size_t tableSize = sizeof(header) + sizeof(uint32) * numChunks;
+	if (store)
+	{
+		out.resize(tableSize + size);
+		memcpy(out.data(), &header, sizeof(header));
+		if (numChunks != 0)
+		{
+			memcpy(out.data() + sizeof(header), &size, sizeof(uint32));
+			memcpy(out.data() + tableSize, data, size);
+		}
+		return;
+	}
+
+	// every chunk gets its worst case slot, the slots are packed once all of them are done
+	const FName format = getFormatName(mCodec);
+	const ECompressionFlags flags = getFlags(mCodec);
+	const size_t slotSize = (size_t)FCompression::CompressMemoryBound(format, (int32)chunkSize, flags);
+	std::vector<char> slots(slotSize * numChunks);
+	std::vector<uint32> sizes(numChunks);
+	auto compressChunk = [&](int32 index)
+	{
+		const char* src = (const char*)data + (size_t)index * chunkSize;
+		const uint32 srcSize = FMath::Min(chunkSize, size - (uint32)index * chunkSize);
+		char* dst = slots.data() + slotSize * index;
+		int32 dstSize = (int32)slotSize;
+		if (!FCompression::CompressMemory(format, dst, dstSize, src, (int32)srcSize, flags) || (uint32)dstSize >= srcSize)
+		{
+			memcpy(dst, src, srcSize);
+			dstSize = (int32)srcSize;
+		}
+		sizes[index] = (uint32)dstSize;
+	};
+	if (parallel)
+		ParallelFor((int32)numChunks, compressChunk);
+	else
+	{
+		for (uint32 i = 0; i < numChunks; ++i)
+			compressChunk((int32)i);
+	}
+
+	size_t total = tableSize;
+	for (auto s : sizes)
+		total += s;
+	out.resize(total);
+	memcpy(out.data(), &header, sizeof(header));
+	memcpy(out.data() + sizeof(header), sizes.data(), sizeof(uint32) * numChunks);
+	char* dst = out.data() + tableSize;
+	for (uint32 i = 0; i < numChunks; ++i)
+	{
+		memcpy(dst, slots.data() + slotSize * i, sizes[i]);
+		dst += sizes[i];
+	}
+}
+
+bool PayloadCompressor::decompress(PayloadCodec codec, const char* data, size_t size, std::vector<char>& out, bool parallel)
+{
+	PayloadHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	if (header.chunkSize == 0 || header.numChunks != (uint32)(((uint64)header.rawSize + header.chunkSize - 1) / header.chunkSize))
+		return false;
+	const size_t tableSize = sizeof(header) + sizeof(uint32) * (size_t)header.numChunks;
+	if (size < tableSize)
+		return false;
+
+	std::vector<uint32> sizes(header.numChunks);
+	std::vector<size_t> offsets(header.numChunks);
+	memcpy(sizes.data(), data + sizeof(header), sizeof(uint32) * header.numChunks);
+	size_t offset = tableSize;
+	for (uint32 i = 0; i < header.numChunks; ++i)
+	{
+		offsets[i] = offset;
+		offset += sizes[i];
+	}
+	if (offset != size)
+		return false;
+
+	out.resize(header.rawSize);
+	std::vector<uint8> failed(header.numChunks, 0);
+	auto decompressChunk = [&](int32 index)
+	{
+		const uint32 rawSize = FMath::Min(header.chunkSize, header.rawSize - (uint32)index * header.chunkSize);
+		char* dst = out.data() + (size_t)index * header.chunkSize;
+		if (sizes[index] == rawSize)
+			memcpy(dst, data + offsets[index], rawSize);
+		else if (codec == PC_None || sizes[index] > rawSize)
+			failed[index] = 1;
+		else
+			failed[index] = !FCompression::UncompressMemory(getFormatName(codec), dst, (int32)rawSize, data + offsets[index], (int32)sizes[index], getFlags(codec));
+	};
+	if (parallel)
+		ParallelFor((int32)header.numChunks, decompressChunk);
+	else
+	{
+		for (uint32 i = 0; i < header.numChunks; ++i)
+			decompressChunk((int32)i);
+	}
+	return std::find(failed.begin(), failed.end(), 1) == failed.end();
+}
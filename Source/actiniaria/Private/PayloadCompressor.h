@@ -0,0 +1,25 @@
+#pragma once
+#include "Core.h"
+#include "Protocol.h"
+
+#include <vector>
+
+// encodes payloads in the chunked layout described in Protocol.h. chunks are compressed independently on the
+// task graph, a chunk that does not get smaller is stored as it is
+class PayloadCompressor
+{
+public:
+	PayloadCompressor(PayloadCodec codec, uint32 chunkSize, uint32 minSize);
+
+	PayloadCodec getCodec() const { return mCodec; }
+	// replaces out with the encoded payload. payloads below minSize are stored without calling the codec
+	void compress(const void* data, uint32 size, std::vector<char>& out, bool parallel = true) const;
+	// false if the encoded payload is malformed or a chunk does not decompress to its size
+	static bool decompress(PayloadCodec codec, const char* data, size_t size, std::vector<char>& out, bool parallel = true);
+	// codecs this build can use as a PayloadCodecMask
+	static uint32 getSupportedCodecs();
+private:
+	PayloadCodec mCodec;
+	uint32 mChunkSize;
+	uint32 mMinSize;
+};
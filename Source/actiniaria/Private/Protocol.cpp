@@ -0,0 +1,166 @@
+#include "Protocol.h"
+
+void ProtocolEncoder::begin(Opcode opcode)
+{
+	mMessage.clear();
+	*this << (uint16_t)opcode;
+}
+
+void ProtocolEncoder::end()
+{
+	auto frame = [this](const std::vector<char>& message)
+	{
+		uint32_t size = (uint32_t)message.size();
+		mFrames.insert(mFrames.end(), (const char*)&size, (const char*)&size + sizeof(size));
+		mFrames.insert(mFrames.end(), message.begin(), message.end());
+	};
+
+	// the receiver needs the names before the message referring to them
+	if (!mNewNames.empty())
+	{
+		std::vector<char> message;
+		message.swap(mMessage);
+		*this << (uint16_t)OP_DefineNames << (uint32_t)(mNameIds.size() - mNewNames.size()) << (uint32_t)mNewNames.size();
+		for (auto& name : mNewNames)
+			*this << name;
+		mNewNames.clear();
+		frame(mMessage);
+		mMessage.swap(message);
+	}
+	frame(mMessage);
+	mMessage.clear();
+}
+
+void ProtocolEncoder::append(const void* data, size_t size)
+{
+	mMessage.insert(mMessage.end(), (const char*)data, (const char*)data + size);
+}
+
+ProtocolEncoder& ProtocolEncoder::operator<<(const std::string& value)
+{
+	return writeBytes(value.data(), (uint32_t)value.size());
+}
+
+ProtocolEncoder& ProtocolEncoder::writeName(const std::string& name)
+{
+	auto ret = mNameIds.emplace(name, (uint32_t)mNameIds.size());
+	if (ret.second)
+	{
+		mNewNames.push_back(name);
+		mNames.push_back(name);
+	}
+	return *this << ret.first->second;
+}
+
+ProtocolEncoder& ProtocolEncoder::writeBytes(const void* data, uint32_t size)
+{
+	*this << size;
+	append(data, size);
+	return *this;
+}
+
+bool ProtocolDecoder::decode(const char* frame, size_t size)
+{
+	mData = frame;
+	mEnd = frame + size;
+	mValid = true;
+
+	uint16_t opcode = 0;
+	*this >> opcode;
+	mOpcode = (Opcode)opcode;
+	if (!mValid || opcode == 0 || opcode >= OP_Count)
+	{
+		mValid = false;
+		return false;
+	}
+	if (mOpcode != OP_DefineNames)
+		return true;
+
+	// ids are handed out in order, a gap means a frame went missing. names defined by the other side cannot grow here
+	uint32_t first = 0, count = 0;
+	*this >> first >> count;
+	if (!mValid || mShared != nullptr || first != mNames.size())
+	{
+		mValid = false;
+		return false;
+	}
+	for (uint32_t i = 0; i < count && mValid; ++i)
+	{
+		std::string name;
+		*this >> name;
+		if (mValid)
+			mNames.push_back(std::move(name));
+	}
+	return isComplete();
+}
+
+void ProtocolDecoder::read(void* data, size_t size)
+{
+	if (!mValid || (size_t)(mEnd - mData) < size)
+	{
+		mValid = false;
+		memset(data, 0, size);
+		return;
+	}
+	memcpy(data, mData, size);
+	mData += size;
+}
+
+ProtocolDecoder& ProtocolDecoder::operator>>(std::string& value)
+{
+	uint32_t size = 0;
+	*this >> size;
+	if (!mValid || (size_t)(mEnd - mData) < size)
+	{
+		mValid = false;
+		value.clear();
+		return *this;
+	}
+	value.assign(mData, size);
+	mData += size;
+	return *this;
+}
+
+ProtocolDecoder& ProtocolDecoder::readName(std::string& name)
+{
+	const std::vector<std::string>& names = mShared != nullptr ? *mShared : mNames;
+	uint32_t id = 0;
+	*this >> id;
+	if (!mValid || id >= names.size())
+	{
+		mValid = false;
+		name.clear();
+		return *this;
+	}
+	name = names[id];
+	return *this;
+}
+
+ProtocolDecoder& ProtocolDecoder::readBytes(std::vector<char>& bytes)
+{
+	uint32_t size = 0;
+	*this >> size;
+	if (!mValid || (size_t)(mEnd - mData) < size)
+	{
+		mValid = false;
+		bytes.clear();
+		return *this;
+	}
+	bytes.assign(mData, mData + size);
+	mData += size;
+	return *this;
+}
+
+bool ProtocolDispatcher::dispatch(const char* frame, size_t size)
+{
+	if (!mDecoder.decode(frame, size))
+		return false;
+	if (mDecoder.getOpcode() == OP_DefineNames)
+		return true;
+
+	auto& handler = mHandlers[mDecoder.getOpcode()];
+	if (!handler)
+		return false;
+	handler(mDecoder);
+	return mDecoder.isComplete();
+}
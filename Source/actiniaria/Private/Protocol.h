@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// binary protocol between the exporter and the render station.
+// no UE dependency, the receiver side and the standalone tests in Tools build it as it is.
+//
+// handshake: right after the connection the exporter sends the SimpleIPC string "protocol", PROTOCOL_VERSION as
+// a UINT and the PayloadCodecMask of the codecs it offers as a UINT. the receiver answers with the version it speaks
+// as a UINT, any other version than PROTOCOL_VERSION ends the export before anything else is sent. then it answers
+// with the PayloadCodec it picked from the offered ones as a UINT, PC_None if it takes payloads as they are.
+//
+// after the handshake the exporter writes raw bytes only: frames, payload descriptors and payload bytes.
+// a frame is a uint32 size followed by size bytes, a uint16 opcode and the fields of the message, little endian
+// without padding. field types:
+//   u8 u16 u32 u64 f32   plain values
+//   vec3 color matrix    3, 4 and 16 f32 (FVector, FLinearColor, FMatrix)
+//   name                 u32 id of a name defined by an earlier OP_DefineNames frame
+//   string               u32 length, bytes
+//   bytes                u32 size, bytes
+// every name is defined once, in an OP_DefineNames frame ahead of the first message using it.
+// payloads follow the frame announcing them. with the shared memory transport a payload is a SharedArena::Descriptor,
+// its bytes follow inline when the position is SharedArena::inlinePosition. without it the bytes follow directly.
+// once a codec other than PC_None was picked, the bytes of every payload are encoded: a PayloadHeader, chunk count x
+// u32 stored chunk size, the chunks. chunk i holds the raw bytes from i x chunk size, the last one may be shorter.
+// a chunk whose stored size equals its raw size is stored as it is, the others are compressed with the codec.
+// descriptor sizes are the encoded sizes, the sizes in the frames stay the raw sizes.
+//
+// the receiver sends its messages as frames without the size prefix, one SimpleIPC string each. names in them are
+// the ids the exporter defined.
+enum Opcode : uint16_t
+{
+	// u32 first id, u32 count, count x string
+	OP_DefineNames = 1,
+	// string arena name, u64 capacity. every payload after it is a SharedArena::Descriptor
+	OP_Transport,
+	// name, vec3 position, vec3 direction, matrix view, matrix projection, f32 x, y, width, height, min depth, max depth
+	OP_CreateCamera,
+	// name, u32 lod count, followed by that many OP_MeshLOD
+	OP_CreateMesh,
+	// f32 screen size, u32 vertex bytes, vertex count, vertex stride, vertex format, vec3 origin, vec3 scale,
+	// u32 index bytes, index count, index stride, u32 submesh count, submeshes (u32 material, start index, index count).
+	// followed by the vertex payload and the index payload
+	OP_MeshLOD,
+	// name, u32 mesh count (1), name mesh, matrix world, matrix inverse world, vec3 center, vec3 extent,
+	// u32 material count, material count x name
+	OP_CreateModel,
+	// name, name mesh, u32 material count, material count x name, u32 instance count, instance stride, instance bytes.
+	// followed by the instance payload
+	OP_CreateInstances,
+	// name, string vertex shader, name pixel shader, string shader text, string bytecode, u32 return bytecode,
+	// u32 texture count, texture count x name, bytes parameters
+	OP_CreateMaterial,
+	// same fields as OP_CreateMaterial
+	OP_UpdateMaterial,
+	// name, bytes parameters
+	OP_UpdateMaterialParameters,
+	// name, u32 width, height, format, u8 srgb, u32 mip count, first mip. followed by mip count - first mip OP_TextureMip
+	OP_CreateTexture,
+	// name, u32 width, height, format, u8 srgb, u32 slice count, mip count. followed by slice count x mip count OP_TextureMip
+	OP_CreateTextureArray,
+	// name, u32 first level, u32 level count. followed by level count OP_TextureMip
+	OP_TextureMips,
+	// u32 level, u32 bytes. followed by the mip payload
+	OP_TextureMip,
+	// name, name mesh, name material, matrix world, vec3 center, vec3 extent
+	OP_CreateSky,
+	// name, u32 type, color, vec3 direction
+	OP_CreateLight,
+	// same fields as OP_CreateLight
+	OP_UpdateLight,
+	// name, matrix world, f32 radius, f32 brightness, u32 cubemap size, u32 bytes. followed by the capture payload
+	OP_CreateReflectionProbe,
+	// name, matrix world, matrix inverse world, vec3 center, vec3 extent
+	OP_UpdateTransform,
+	// name
+	OP_DestroyModel,
+	// name
+	OP_DestroyLight,
+	// no fields, closes the deltas of one editor tick
+	OP_Commit,
+	// no fields, the export was cancelled
+	OP_Cancel,
+	// no fields, the scene is complete
+	OP_Done,
+
+	// receiver to exporter
+	// name texture, u32 level
+	OP_RequestTextureMips,
+	// name pixel shader, bytes bytecode
+	OP_ShaderBytecode,
+	// no fields, no more requests follow
+	OP_EndStreaming,
+
+	OP_Count
+};
+
+static const uint32_t PROTOCOL_VERSION = 2;
+
+enum PayloadCodec : uint32_t
+{
+	PC_None,
+	// fast, for live sync and tunnelled pipes
+	PC_LZ4,
+	// slower with a better ratio, for streams written to disk
+	PC_Zlib,
+
+	PC_Count
+};
+
+// bit 1 << codec is set for every offered codec
+typedef uint32_t PayloadCodecMask;
+
+struct PayloadHeader
+{
+	uint32_t rawSize;
+	uint32_t chunkSize;
+	uint32_t numChunks;
+};
+
+// builds frames. names are given ids on their first use and defined ahead of the message using them
+class ProtocolEncoder
+{
+public:
+	void begin(Opcode opcode);
+	// closes the message started by begin, its frames are appended to getFrames()
+	void end();
+
+	template<class T>
+	ProtocolEncoder& operator<<(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "write plain values only");
+		append(&value, sizeof(T));
+		return *this;
+	}
+	ProtocolEncoder& operator<<(const std::string& value);
+	ProtocolEncoder& operator<<(const char* value) { return *this << std::string(value); }
+	ProtocolEncoder& writeName(const std::string& name);
+	ProtocolEncoder& writeBytes(const void* data, uint32_t size);
+
+	const std::vector<char>& getFrames() const { return mFrames; }
+	void clearFrames() { mFrames.clear(); }
+	uint32_t getNumNames() const { return (uint32_t)mNames.size(); }
+	// indexed by id
+	const std::vector<std::string>& getNames() const { return mNames; }
+private:
+	void append(const void* data, size_t size);
+
+	std::vector<char> mMessage;
+	std::vector<char> mFrames;
+	std::unordered_map<std::string, uint32_t> mNameIds;
+	std::vector<std::string> mNames;
+	std::vector<std::string> mNewNames;
+};
+
+// reads one frame at a time, without its size prefix. names defined by OP_DefineNames frames are kept for the
+// frames after them. reads past the end of a frame or of unknown names only clear isValid(), they never read outside
+class ProtocolDecoder
+{
+public:
+	// false if the frame has no opcode or is a malformed OP_DefineNames, which is applied here
+	bool decode(const char* frame, size_t size);
+	Opcode getOpcode() const { return mOpcode; }
+
+	template<class T>
+	ProtocolDecoder& operator>>(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "read plain values only");
+		read(&value, sizeof(T));
+		return *this;
+	}
+	ProtocolDecoder& operator>>(std::string& value);
+	ProtocolDecoder& readName(std::string& name);
+	ProtocolDecoder& readBytes(std::vector<char>& bytes);
+
+	bool isValid() const { return mValid; }
+	// every field of the frame was read
+	bool isComplete() const { return mValid && mData == mEnd; }
+	uint32_t getNumNames() const { return (uint32_t)mNames.size(); }
+	// names of the encoder on this side, for frames from the receiver which only refers to them
+	void shareNames(const std::vector<std::string>* names) { mShared = names; }
+private:
+	void read(void* data, size_t size);
+
+	std::vector<std::string> mNames;
+	const std::vector<std::string>* mShared = nullptr;
+	const char* mData = nullptr;
+	const char* mEnd = nullptr;
+	Opcode mOpcode = OP_Count;
+	bool mValid = false;
+};
+
+// handlers indexed by opcode, a frame is dispatched without comparing strings
+class ProtocolDispatcher
+{
+public:
+	typedef std::function<void(ProtocolDecoder& decoder)> Handler;
+
+	ProtocolDispatcher() : mHandlers(OP_Count) {}
+	void set(Opcode opcode, Handler handler) { mHandlers[opcode] = std::move(handler); }
+	// false for malformed frames, opcodes without handler and handlers that did not read the frame exactly
+	bool dispatch(const char* frame, size_t size);
+	ProtocolDecoder& getDecoder() { return mDecoder; }
+private:
+	std::vector<Handler> mHandlers;
+	ProtocolDecoder mDecoder;
+};
@@ -0,0 +1,219 @@
+#include "SharedArena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <new>
+
+#if defined(_WIN32)
+#	if defined(__has_include)
+#		if __has_include("Windows/MinWindows.h")
+#			include "Windows/MinWindows.h"
+#		else
+#			include <windows.h>
+#		endif
+#	else
+#		include <windows.h>
+#	endif
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+static const uint32_t ARENA_MAGIC = 0x41435441; // "ATCA"
+static const uint32_t ARENA_VERSION = 1;
+
+static uint64_t alignUp(uint64_t v, uint64_t a)
+{
+	return (v + a - 1) / a * a;
+}
+
+size_t SharedArena::headerSize()
+{
+	return (size_t)alignUp(sizeof(Header), alignment);
+}
+
+SharedArena::~SharedArena()
+{
+	close();
+}
+
+bool SharedArena::create(const std::string& name, size_t capacity)
+{
+	close();
+	mName = name;
+	mOwner = true;
+	mCapacity = (size_t)alignUp(capacity, alignment);
+	if (!map(headerSize() + mCapacity, true))
+	{
+		close();
+		return false;
+	}
+
+	new (mHeader) Header();
+	mHeader->magic = ARENA_MAGIC;
+	mHeader->version = ARENA_VERSION;
+	mHeader->capacity = mCapacity;
+	mHeader->tail.store(0, std::memory_order_release);
+	mHead = 0;
+	return true;
+}
+
+bool SharedArena::open(const std::string& name)
+{
+	close();
+	mName = name;
+	mOwner = false;
+	if (!map(0, false) || mHeader->magic != ARENA_MAGIC || mHeader->version != ARENA_VERSION)
+	{
+		close();
+		return false;
+	}
+	mCapacity = (size_t)mHeader->capacity;
+	return true;
+}
+
+char* SharedArena::acquire(uint32_t size, uint32_t type, Descriptor& desc, uint32_t timeoutms)
+{
+	if (!valid())
+		return nullptr;
+
+	uint64_t need = alignUp(size, alignment);
+	if (need > mCapacity)
+		return nullptr;
+
+	// payloads never wrap, a payload that does not fit starts at the next lap and the skipped rest is free once read
+	uint64_t offset = mHead % mCapacity;
+	uint64_t pad = offset + need > mCapacity ? mCapacity - offset : 0;
+	uint64_t start = mHead + pad;
+	uint64_t end = start + need;
+	// the payload overwrites what was written one lap before it, unless the receiver already read everything
+	uint64_t required = end > mCapacity ? end - mCapacity : 0;
+	if (required > mHead)
+		required = mHead;
+
+	// short waits are spun, longer ones sleep with a growing interval
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutms);
+	auto backoff = std::chrono::microseconds(50);
+	for (int spins = 0; mHeader->tail.load(std::memory_order_acquire) < required; ++spins)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+			return nullptr;
+		if (spins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(backoff, deadline - now));
+		backoff = std::min(backoff * 2, std::chrono::microseconds(2000));
+	}
+
+	desc.position = start;
+	desc.size = size;
+	desc.type = type;
+	mHead = end;
+	return base() + desc.position % mCapacity;
+}
+
+const char* SharedArena::data(const Descriptor& desc) const
+{
+	if (!valid() || desc.position == inlinePosition)
+		return nullptr;
+	return base() + desc.position % mCapacity;
+}
+
+void SharedArena::release(const Descriptor& desc)
+{
+	if (!valid() || desc.position == inlinePosition)
+		return;
+	mHeader->tail.store(desc.position + alignUp(desc.size, alignment), std::memory_order_release);
+}
+
+#if defined(_WIN32)
+
+bool SharedArena::map(size_t bytes, bool creating)
+{
+	std::string path = "Local\\" + mName;
+	if (creating)
+	{
+		mHandle = ::CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)(bytes & 0xffffffff), path.c_str());
+		if (mHandle != NULL && ::GetLastError() == ERROR_ALREADY_EXISTS)
+			return false;
+	}
+	else
+		mHandle = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+
+	if (mHandle == NULL)
+		return false;
+
+	mHeader = (Header*)::MapViewOfFile(mHandle, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+	mMapped = bytes;
+	return mHeader != nullptr;
+}
+
+void SharedArena::close()
+{
+	if (mHeader)
+		::UnmapViewOfFile(mHeader);
+	if (mHandle)
+		::CloseHandle(mHandle);
+	mHeader = nullptr;
+	mHandle = nullptr;
+	mCapacity = 0;
+	mMapped = 0;
+	mHead = 0;
+	mOwner = false;
+}
+
+#else
+
+bool SharedArena::map(size_t bytes, bool creating)
+{
+	std::string path = "/" + mName;
+	mHandle = creating ?
+		::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) :
+		::shm_open(path.c_str(), O_RDWR, 0600);
+	if (mHandle < 0)
+		return false;
+
+	if (creating)
+	{
+		if (::ftruncate(mHandle, (off_t)bytes) != 0)
+			return false;
+	}
+	else
+	{
+		struct stat st;
+		if (::fstat(mHandle, &st) != 0 || (size_t)st.st_size < headerSize())
+			return false;
+		bytes = (size_t)st.st_size;
+	}
+
+	void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mHandle, 0);
+	if (ptr == MAP_FAILED)
+		return false;
+	mHeader = (Header*)ptr;
+	mMapped = bytes;
+	return true;
+}
+
+void SharedArena::close()
+{
+	if (mHeader)
+		::munmap(mHeader, mMapped);
+	if (mHandle >= 0)
+		::close(mHandle);
+	if (mOwner && !mName.empty())
+		::shm_unlink(("/" + mName).c_str());
+	mHeader = nullptr;
+	mHandle = -1;
+	mCapacity = 0;
+	mMapped = 0;
+	mHead = 0;
+	mOwner = false;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// shared memory ring for bulk payloads.
+// the exporter copies payloads into the mapped region and only sends a Descriptor over the control channel,
+// the receiver maps the same region by name, reads the payload in place and releases it in arrival order.
+// no UE dependency, the standalone tests in Tools run it on the POSIX backend as well.
+class SharedArena
+{
+public:
+	enum PayloadType : uint32_t
+	{
+		PT_Vertices,
+		PT_Indices,
+		PT_Texture,
+		PT_ReflectionCapture,
+		PT_Instances,
+	};
+
+	struct Descriptor
+	{
+		// monotonic byte position, the payload lives at position % capacity
+		uint64_t position;
+		uint32_t size;
+		uint32_t type;
+	};
+
+	// descriptor position of payloads that did not fit into the arena, their bytes follow inline on the control channel
+	static const uint64_t inlinePosition = ~0ull;
+	static const uint32_t alignment = 64;
+
+	SharedArena() = default;
+	~SharedArena();
+	SharedArena(const SharedArena&) = delete;
+	SharedArena& operator=(const SharedArena&) = delete;
+
+	// writer side, creates a new region of capacity bytes
+	bool create(const std::string& name, size_t capacity);
+	// receiver side, maps an existing region
+	bool open(const std::string& name);
+	void close();
+
+	// reserves size bytes for the writer, blocks until the receiver has released enough space or timeoutms passed.
+	// returns nullptr if the payload can never fit or the receiver did not catch up in time
+	char* acquire(uint32_t size, uint32_t type, Descriptor& desc, uint32_t timeoutms);
+
+	const char* data(const Descriptor& desc) const;
+	// receiver side, descriptors must be released in the order they were acquired
+	void release(const Descriptor& desc);
+
+	bool valid() const { return mHeader != nullptr; }
+	size_t capacity() const { return mCapacity; }
+	const std::string& name() const { return mName; }
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t capacity;
+		alignas(64) std::atomic<uint64_t> tail;
+	};
+
+	static size_t headerSize();
+	char* base() const { return (char*)mHeader + headerSize(); }
+	bool map(size_t bytes, bool creating);
+
+private:
+	std::string mName;
+	Header* mHeader = nullptr;
+	size_t mCapacity = 0;
+	size_t mMapped = 0;
+	uint64_t mHead = 0;
+	bool mOwner = false;
+#if defined(_WIN32)
+	void* mHandle = nullptr;
+#else
+	int mHandle = -1;
+#endif
+};
@@ -0,0 +1,181 @@
+#include "TextureConverter.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ACTINIARIA_SSE 1
+#include <emmintrin.h>
+#else
+#define ACTINIARIA_SSE 0
+#endif
+
+static const uint16_t HALF_ONE = 0x3c00;
+
+uint32_t TextureConverter::getBytesPerPixel(SourceFormat format)
+{
+	switch (format)
+	{
+	case SF_G8: return 1;
+	case SF_G16: return 2;
+	case SF_BGRA8:
+	case SF_RGBA8:
+	case SF_BGRE8:
+	case SF_RGBE8: return 4;
+	case SF_RGBA16:
+	case SF_RGBA16F: return 8;
+	default: return 0;
+	}
+}
+
+MipGenerator::PixelFormat TextureConverter::getTargetFormat(SourceFormat format)
+{
+	switch (format)
+	{
+	case SF_G8: return MipGenerator::PF_R8;
+	case SF_G16: return MipGenerator::PF_R16;
+	case SF_RGBA16: return MipGenerator::PF_RGBA16;
+	// shared exponent has no gpu format, it is decoded to half
+	case SF_BGRE8:
+	case SF_RGBE8:
+	case SF_RGBA16F: return MipGenerator::PF_RGBA16F;
+	default: return MipGenerator::PF_BGRA8;
+	}
+}
+
+bool TextureConverter::isCopy() const
+{
+	return mFormat != SF_RGBA8 && mFormat != SF_BGRE8 && mFormat != SF_RGBE8;
+}
+
+void TextureConverter::convert(const uint8_t* src, uint8_t* dst, size_t count, bool simd) const
+{
+	size_t done = 0;
+	switch (mFormat)
+	{
+	case SF_RGBA8:
+		done = simd ? swizzleSSE(src, dst, count) : 0;
+		swizzleScalar(src + done * 4, dst + done * 4, count - done);
+		break;
+	case SF_BGRE8:
+	case SF_RGBE8:
+		done = simd ? decodeRGBESSE(src, dst, count) : 0;
+		decodeRGBEScalar(src + done * 4, dst + done * 8, count - done);
+		break;
+	default:
+		memcpy(dst, src, count * getBytesPerPixel(mFormat));
+		break;
+	}
+}
+
+void TextureConverter::swizzleScalar(const uint8_t* src, uint8_t* dst, size_t count) const
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i * 4 + 0] = src[i * 4 + 2];
+		dst[i * 4 + 1] = src[i * 4 + 1];
+		dst[i * 4 + 2] = src[i * 4 + 0];
+		dst[i * 4 + 3] = src[i * 4 + 3];
+	}
+}
+
+void TextureConverter::decodeRGBEScalar(const uint8_t* src, uint8_t* dst, size_t count) const
+{
+	// same as FColor::FromRGBE, color * 2^(e - 128) / 255 and alpha 1
+	const int red = mFormat == SF_BGRE8 ? 2 : 0;
+	const int blue = 2 - red;
+	uint16_t* out = (uint16_t*)dst;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint8_t* p = src + i * 4;
+		float scale = p[3] == 0 ? 0.0f : std::ldexp(1.0f / 255.0f, (int)p[3] - 128);
+		out[i * 4 + 0] = MipGenerator::floatToHalf(p[red] * scale);
+		out[i * 4 + 1] = MipGenerator::floatToHalf(p[1] * scale);
+		out[i * 4 + 2] = MipGenerator::floatToHalf(p[blue] * scale);
+		out[i * 4 + 3] = HALF_ONE;
+	}
+}
+
+#if ACTINIARIA_SSE
+// round to nearest even, including denormals, infinities and nans. the result is in the low 16 bits of each lane
+static __m128i floatToHalfSSE(__m128 f)
+{
+	const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+	const __m128i maxHalf = _mm_set1_epi32((127 + 16) << 23);
+	const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+	const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+	const __m128i infinity = _mm_set1_epi32(0x7c00);
+	const __m128i nanBit = _mm_set1_epi32(0x200);
+
+	__m128 sign = _mm_and_ps(_mm_castsi128_ps(signMask), f);
+	__m128 absf = _mm_xor_ps(f, sign);
+	__m128i absi = _mm_castps_si128(absf);
+
+	__m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+	__m128i isRegular = _mm_cmpgt_epi32(maxHalf, absi);
+	__m128i special = _mm_or_si128(_mm_and_si128(isNaN, nanBit), infinity);
+
+	// the float add rounds the mantissa for results below the smallest normal half
+	__m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absi);
+	__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+	__m128i odd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+	__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, normalBias), odd), 13);
+
+	__m128i value = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+	value = _mm_or_si128(_mm_and_si128(isRegular, value), _mm_andnot_si128(isRegular, special));
+	return _mm_and_si128(_mm_or_si128(value, _mm_srli_epi32(_mm_castps_si128(sign), 16)), _mm_set1_epi32(0xffff));
+}
+#endif
+
+size_t TextureConverter::swizzleSSE(const uint8_t* src, uint8_t* dst, size_t count) const
+{
+	size_t i = 0;
+#if ACTINIARIA_SSE
+	const __m128i keep = _mm_set1_epi32((int)0xff00ff00u);
+	const __m128i low = _mm_set1_epi32(0xff);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+		__m128i r = _mm_and_si128(v, low);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+		v = _mm_or_si128(_mm_and_si128(v, keep), _mm_or_si128(_mm_slli_epi32(r, 16), b));
+		_mm_storeu_si128((__m128i*)(dst + i * 4), v);
+	}
+#endif
+	return i;
+}
+
+size_t TextureConverter::decodeRGBESSE(const uint8_t* src, uint8_t* dst, size_t count) const
+{
+	size_t i = 0;
+#if ACTINIARIA_SSE
+	const __m128i low = _mm_set1_epi32(0xff);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+	const __m128i alpha = _mm_set1_epi32(HALF_ONE << 16);
+	const __m128i redShift = _mm_cvtsi32_si128(mFormat == SF_BGRE8 ? 16 : 0);
+	const __m128i blueShift = _mm_cvtsi32_si128(mFormat == SF_BGRE8 ? 0 : 16);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+		__m128i e = _mm_srli_epi32(v, 24);
+
+		// 2^(e - 128) has the float exponent field e - 1, e == 1 flushes to zero
+		__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(e, one), 23));
+		scale = _mm_and_ps(_mm_mul_ps(scale, inv255), _mm_castsi128_ps(_mm_cmpgt_epi32(e, one)));
+
+		__m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(v, redShift), low)), scale);
+		__m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 8), low)), scale);
+		__m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(v, blueShift), low)), scale);
+
+		// lanes of rg and ba are the two 32 bit halves of one output pixel
+		__m128i rg = _mm_or_si128(floatToHalfSSE(r), _mm_slli_epi32(floatToHalfSSE(g), 16));
+		__m128i ba = _mm_or_si128(floatToHalfSSE(b), alpha);
+		_mm_storeu_si128((__m128i*)(dst + i * 8), _mm_unpacklo_epi32(rg, ba));
+		_mm_storeu_si128((__m128i*)(dst + i * 8 + 16), _mm_unpackhi_epi32(rg, ba));
+	}
+#endif
+	return i;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MipGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// converts texture source pixels to a format the render station can create directly.
+// plain layouts are copied, RGBA8 is swizzled to BGRA8 and shared exponent RGBE is decoded to half floats.
+// no UE dependency, Tools/Tests compares its simd and scalar paths and actiniaria_bench times them.
+class TextureConverter
+{
+public:
+	enum SourceFormat : uint32_t
+	{
+		SF_G8,
+		SF_G16,
+		SF_BGRA8,
+		SF_RGBA8,
+		// B, G, R, shared exponent
+		SF_BGRE8,
+		// R, G, B, shared exponent
+		SF_RGBE8,
+		SF_RGBA16,
+		SF_RGBA16F,
+	};
+
+	explicit TextureConverter(SourceFormat format) : mFormat(format) {}
+
+	// converts count pixels, dst must hold count * getTargetBytesPerPixel() bytes
+	void convert(const uint8_t* src, uint8_t* dst, size_t count, bool simd = true) const;
+
+	static uint32_t getBytesPerPixel(SourceFormat format);
+	static MipGenerator::PixelFormat getTargetFormat(SourceFormat format);
+	MipGenerator::PixelFormat getTargetFormat() const { return getTargetFormat(mFormat); }
+	uint32_t getTargetBytesPerPixel() const { return MipGenerator::getBytesPerPixel(getTargetFormat()); }
+	// true when convert only copies
+	bool isCopy() const;
+private:
+	void swizzleScalar(const uint8_t* src, uint8_t* dst, size_t count) const;
+	void decodeRGBEScalar(const uint8_t* src, uint8_t* dst, size_t count) const;
+	size_t swizzleSSE(const uint8_t* src, uint8_t* dst, size_t count) const;
+	size_t decodeRGBESSE(const uint8_t* src, uint8_t* dst, size_t count) const;
+private:
+	SourceFormat mFormat;
+};
@@ -0,0 +1,273 @@
+#include "VertexPacker.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ACTINIARIA_SSE 1
+#include <emmintrin.h>
+#else
+#define ACTINIARIA_SSE 0
+#endif
+
+static_assert(VertexPacker::stride == 60, "createMesh vertex layout changed");
+static_assert(sizeof(FPackedNormal) == 4 && sizeof(FPackedRGBA16N) == 8, "unexpected packed normal size");
+
+template<class T>
+static FORCEINLINE void move(char*& data, const T& value)
+{
+	memcpy(data, &value, sizeof(value));
+	data += sizeof(value);
+}
+
+UINT VertexPacker::getStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case VF_Compact: return sizeof(FVector) + sizeof(FVector2DHalf) + sizeof(uint32) * 2 + sizeof(FColor);
+	case VF_CompactQuantized: return sizeof(uint16) * 4 + sizeof(FVector2DHalf) + sizeof(uint32) * 2 + sizeof(FColor);
+	default: return stride;
+	}
+}
+
+VertexPacker::VertexPacker(const FPositionVertexBuffer& positions, const FStaticMeshVertexBuffer& vertices, const FColorVertexBuffer& colors,
+	VertexFormat format, const FBoxSphereBounds* bounds):
+	mFormat(format)
+{
+	if (mFormat == VF_CompactQuantized)
+	{
+		check(bounds);
+		mOrigin = bounds->Origin - bounds->BoxExtent;
+		mScale = bounds->BoxExtent * 2.0f;
+	}
+
+	mNumVertices = positions.GetNumVertices();
+	mNumColors = colors.GetNumVertices();
+	mNumTexCoords = vertices.GetNumTexCoords();
+	mHighPrecisionTangents = vertices.GetUseHighPrecisionTangentBasis();
+	mFullPrecisionUVs = vertices.GetUseFullPrecisionUVs();
+
+	if (mNumVertices == 0)
+		return;
+
+	check(vertices.GetNumVertices() == mNumVertices && mNumTexCoords > 0);
+	mPositions = &positions.VertexPosition(0);
+	mTangents = (const uint8*)vertices.GetTangentData();
+	mUVs = (const uint8*)vertices.GetTexCoordData();
+	mColors = mNumColors > 0 ? &colors.VertexColor(0) : nullptr;
+}
+
+void VertexPacker::pack(char* dst, UINT first, UINT count, bool simd) const
+{
+	check(first + count <= mNumVertices);
+	if (count == 0)
+		return;
+
+	if (mFormat != VF_Full)
+	{
+		if (mHighPrecisionTangents)
+		{
+			if (mFullPrecisionUVs)
+				packCompact<FPackedRGBA16N, FVector2D>(dst, first, count);
+			else
+				packCompact<FPackedRGBA16N, FVector2DHalf>(dst, first, count);
+		}
+		else
+		{
+			if (mFullPrecisionUVs)
+				packCompact<FPackedNormal, FVector2D>(dst, first, count);
+			else
+				packCompact<FPackedNormal, FVector2DHalf>(dst, first, count);
+		}
+		return;
+	}
+
+#if ACTINIARIA_SSE
+	if (simd)
+	{
+		if (mHighPrecisionTangents)
+		{
+			if (mFullPrecisionUVs)
+				packSSEHighPrecision<FVector2D>(dst, first, count);
+			else
+				packSSEHighPrecision<FVector2DHalf>(dst, first, count);
+		}
+		else
+		{
+			if (mFullPrecisionUVs)
+				packSSE<FVector2D>(dst, first, count);
+			else
+				packSSE<FVector2DHalf>(dst, first, count);
+		}
+		return;
+	}
+#endif
+
+	if (mHighPrecisionTangents)
+	{
+		if (mFullPrecisionUVs)
+			packScalar<FPackedRGBA16N, FVector2D>(dst, first, count);
+		else
+			packScalar<FPackedRGBA16N, FVector2DHalf>(dst, first, count);
+	}
+	else
+	{
+		if (mFullPrecisionUVs)
+			packScalar<FPackedNormal, FVector2D>(dst, first, count);
+		else
+			packScalar<FPackedNormal, FVector2DHalf>(dst, first, count);
+	}
+}
+
+template<class TangentT, class UVT>
+void VertexPacker::packScalar(char* dst, UINT first, UINT count) const
+{
+	// tangent datum is { TangentX, TangentZ }, binormal is derived like FStaticMeshVertexBuffer::VertexTangentY
+	auto tangents = (const TangentT*)mTangents;
+	for (UINT i = first; i < first + count; ++i)
+	{
+		FVector4 tangentX = tangents[i * 2].ToFVector4();
+		FVector4 tangentZ = tangents[i * 2 + 1].ToFVector4();
+
+		FVector normal(tangentZ);
+		FVector tangent(tangentX);
+		FVector binormal = (normal ^ tangent) * tangentZ.W;
+
+		move(dst, mPositions[i]);
+		move(dst, getUV<UVT>(i));
+		move(dst, normal);
+		move(dst, tangent);
+		move(dst, binormal);
+		move(dst, getColor(i));
+	}
+}
+
+static FORCEINLINE uint32 encodeR10G10B10A2(const FVector& v, uint32 a)
+{
+	auto unorm10 = [](float x)
+	{
+		return (uint32)FMath::RoundToInt(FMath::Clamp(x * 0.5f + 0.5f, 0.0f, 1.0f) * 1023.0f);
+	};
+	return unorm10(v.X) | (unorm10(v.Y) << 10) | (unorm10(v.Z) << 20) | (a << 30);
+}
+
+static FORCEINLINE uint16 quantize16(float v, float origin, float scale)
+{
+	if (scale <= 0.0f)
+		return 0;
+	return (uint16)FMath::RoundToInt(FMath::Clamp((v - origin) / scale, 0.0f, 1.0f) * 65535.0f);
+}
+
+static FORCEINLINE FVector2DHalf toHalf(const FVector2D& uv)
+{
+	return FVector2DHalf(uv);
+}
+
+static FORCEINLINE FVector2DHalf toHalf(const FVector2DHalf& uv)
+{
+	return uv;
+}
+
+template<class TangentT, class UVT>
+void VertexPacker::packCompact(char* dst, UINT first, UINT count) const
+{
+	auto tangents = (const TangentT*)mTangents;
+	auto uvs = (const UVT*)mUVs;
+	for (UINT i = first; i < first + count; ++i)
+	{
+		FVector4 tangentX = tangents[i * 2].ToFVector4();
+		FVector4 tangentZ = tangents[i * 2 + 1].ToFVector4();
+
+		const FVector& pos = mPositions[i];
+		if (mFormat == VF_CompactQuantized)
+		{
+			uint16 q[4] = {
+				quantize16(pos.X, mOrigin.X, mScale.X),
+				quantize16(pos.Y, mOrigin.Y, mScale.Y),
+				quantize16(pos.Z, mOrigin.Z, mScale.Z),
+				0
+			};
+			move(dst, q);
+		}
+		else
+			move(dst, pos);
+
+		move(dst, toHalf(uvs[i * mNumTexCoords]));
+		move(dst, encodeR10G10B10A2(FVector(tangentZ), 0));
+		// binormal = cross(normal, tangent) * sign
+		move(dst, encodeR10G10B10A2(FVector(tangentX), tangentZ.W < 0.0f ? 0 : 3));
+		move(dst, getColor(i));
+	}
+}
+
+#if ACTINIARIA_SSE
+
+static FORCEINLINE __m128 cross(__m128 a, __m128 b)
+{
+	__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static FORCEINLINE __m128 toFloat(__m128i v, __m128 scale)
+{
+	return _mm_mul_ps(_mm_cvtepi32_ps(v), scale);
+}
+
+static FORCEINLINE void writeVertex(char* dst, const FVector& pos, const FVector2D& uv, __m128 x, __m128 z, const FColor& color)
+{
+	__m128 w = _mm_shuffle_ps(z, z, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 y = _mm_mul_ps(cross(z, x), w);
+
+	// float3 fields are written with 16 byte stores in field order,
+	// the 4 bytes spilled by each store are overwritten by the next field and never leave the vertex
+	memcpy(dst, &pos, sizeof(FVector));
+	memcpy(dst + 12, &uv, sizeof(FVector2D));
+	_mm_storeu_ps((float*)(dst + 20), z);
+	_mm_storeu_ps((float*)(dst + 32), x);
+	_mm_storeu_ps((float*)(dst + 44), y);
+	memcpy(dst + 56, &color, sizeof(FColor));
+}
+
+template<class UVT>
+void VertexPacker::packSSE(char* dst, UINT first, UINT count) const
+{
+	// FPackedNormal is 4 x int8 snorm, one 16 byte load covers the tangent datums of 2 vertices
+	const __m128 scale = _mm_set1_ps(1.0f / 127.0f);
+	UINT i = first;
+	UINT end = first + count;
+	for (; i + 2 <= end; i += 2)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i*)(mTangents + i * 8));
+		// sign extend int8 -> int16 -> int32
+		__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(packed, packed), 8);
+		__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(packed, packed), 8);
+		__m128 x0 = toFloat(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), scale);
+		__m128 z0 = toFloat(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), scale);
+		__m128 x1 = toFloat(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), scale);
+		__m128 z1 = toFloat(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), scale);
+
+		writeVertex(dst, mPositions[i], getUV<UVT>(i), x0, z0, getColor(i));
+		writeVertex(dst + stride, mPositions[i + 1], getUV<UVT>(i + 1), x1, z1, getColor(i + 1));
+		dst += stride * 2;
+	}
+
+	if (i < end)
+		packScalar<FPackedNormal, UVT>(dst, i, end - i);
+}
+
+template<class UVT>
+void VertexPacker::packSSEHighPrecision(char* dst, UINT first, UINT count) const
+{
+	// FPackedRGBA16N is 4 x int16 snorm, one 16 byte load is the tangent datum of 1 vertex
+	const __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+	for (UINT i = first; i < first + count; ++i)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i*)(mTangents + i * 16));
+		__m128 x = toFloat(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16), scale);
+		__m128 z = toFloat(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16), scale);
+
+		writeVertex(dst, mPositions[i], getUV<UVT>(i), x, z, getColor(i));
+		dst += stride;
+	}
+}
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include "Core.h"
+
+#include "Rendering/PositionVertexBuffer.h"
+#include "Rendering/StaticMeshVertexBuffer.h"
+#include "Rendering/ColorVertexBuffer.h"
+
+// vertex layouts of createMesh, the format is sent in the message header
+enum VertexFormat : UINT
+{
+	// float3 pos, float2 uv, float3 normal, float3 tangent, float3 binormal, FColor
+	VF_Full,
+	// float3 pos, half2 uv, normal R10G10B10A2_UNORM, tangent R10G10B10A2_UNORM with the binormal sign in A, FColor
+	VF_Compact,
+	// as VF_Compact but pos is R16G16B16A16_UNORM, pos = origin + pos.xyz * scale
+	VF_CompactQuantized,
+};
+
+// interleaves the cpu copies of the static mesh vertex buffers into one of the VertexFormat layouts
+class VertexPacker
+{
+public:
+	// stride of VF_Full
+	static const UINT stride =
+		sizeof(FVector) +  // pos
+		sizeof(FVector2D) + //uv
+		sizeof(FVector) +  // normal
+		sizeof(FVector) +  // tangent
+		sizeof(FVector) +// binormal
+		sizeof(FColor); // color
+
+	// bounds is required by VF_CompactQuantized
+	VertexPacker(const FPositionVertexBuffer& positions, const FStaticMeshVertexBuffer& vertices, const FColorVertexBuffer& colors,
+		VertexFormat format = VF_Full, const FBoxSphereBounds* bounds = nullptr);
+
+	// packs vertices [first, first + count) to dst, dst must hold count * getStride() bytes
+	void pack(char* dst, UINT first, UINT count, bool simd = true) const;
+
+	static UINT getStride(VertexFormat format);
+	UINT getStride() const { return getStride(mFormat); }
+	VertexFormat getFormat() const { return mFormat; }
+	UINT getNumVertices()const { return mNumVertices; }
+	// position dequantization, identity unless the format is VF_CompactQuantized
+	const FVector& getOrigin() const { return mOrigin; }
+	const FVector& getScale() const { return mScale; }
+private:
+	template<class TangentT, class UVT>
+	void packCompact(char* dst, UINT first, UINT count) const;
+
+	template<class TangentT, class UVT>
+	void packScalar(char* dst, UINT first, UINT count) const;
+	template<class UVT>
+	void packSSE(char* dst, UINT first, UINT count) const;
+	template<class UVT>
+	void packSSEHighPrecision(char* dst, UINT first, UINT count) const;
+
+	FColor getColor(UINT index) const
+	{
+		return index < mNumColors ? mColors[index] : FColor(0xffffffff);
+	}
+
+	template<class UVT>
+	FVector2D getUV(UINT index) const
+	{
+		return FVector2D(((const UVT*)mUVs)[index * mNumTexCoords]);
+	}
+private:
+	const FVector* mPositions = nullptr;
+	const uint8* mTangents = nullptr;
+	const uint8* mUVs = nullptr;
+	const FColor* mColors = nullptr;
+	UINT mNumVertices = 0;
+	UINT mNumColors = 0;
+	UINT mNumTexCoords = 0;
+	bool mHighPrecisionTangents = false;
+	bool mFullPrecisionUVs = false;
+	VertexFormat mFormat = VF_Full;
+	FVector mOrigin = FVector::ZeroVector;
+	FVector mScale = FVector(1.0f, 1.0f, 1.0f);
+};
@@ -8,9 +8,13 @@
 
 #include "LevelEditor.h"
 #include "IPCFrame.h"
+#include "LiveSync.h"
+#include "ExportJob.h"
 #include <thread>
 
 
+DEFINE_LOG_CATEGORY(LogActiniaria);
+
 static const FName actiniariaTabName("actiniaria");
 
 #define LOCTEXT_NAMESPACE "FactiniariaModule"
@@ -29,7 +33,13 @@ void FactiniariaModule::StartupModule()
 	PluginCommands->MapAction(
 		FactiniariaCommands::Get().PluginAction,
 		FExecuteAction::CreateRaw(this, &FactiniariaModule::PluginButtonClicked),
-		FCanExecuteAction());
+		FCanExecuteAction::CreateLambda([this]() { return !IsLiveSyncEnabled() && !IsExporting(); }));
+
+	PluginCommands->MapAction(
+		FactiniariaCommands::Get().LiveSyncAction,
+		FExecuteAction::CreateRaw(this, &FactiniariaModule::LiveSyncClicked),
+		FCanExecuteAction::CreateLambda([this]() { return !IsExporting(); }),
+		FIsActionChecked::CreateRaw(this, &FactiniariaModule::IsLiveSyncEnabled));
 		
 	FLevelEditorModule& LevelEditorModule = FModuleManager::LoadModuleChecked<FLevelEditorModule>("LevelEditor");
 	
@@ -52,6 +62,9 @@ void FactiniariaModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	mLiveSync.reset();
+	mExportJob.reset();
+
 	FactiniariaStyle::Shutdown();
 
 	FactiniariaCommands::Unregister();
@@ -59,48 +72,42 @@ void FactiniariaModule::ShutdownModule()
 
 void FactiniariaModule::PluginButtonClicked()
 {
-	ShowWindow(::GetActiveWindow(), SW_MINIMIZE);
-
-
-	//{
-	//	IPCFrame frame;
-
-	//	auto thread = std::thread([&ipc = frame]() {
-	//		ActiniariaFrame frame;
-	//		try{
-	//			frame.init();
-	//			frame.update();
-	//		}
-	//		catch (...)
-	//		{
-	//			frame.rendercmd.invalid();
-	//			ipc.rendercmd.record();
-	//		}
-	//	});
-
-	//	frame.init();
-
-	//	thread.join();
-	//}
-
+	// the editor stays usable while the job sends the scene, progress and cancel are in the notification
+	mExportJob = std::make_shared<ExportJob>();
+}
 
-	//while(true)
+void FactiniariaModule::LiveSyncClicked()
+{
+	if (IsLiveSyncEnabled())
 	{
-		IPCFrame frame;
-		frame.init();
-
+		mLiveSync.reset();
+		return;
 	}
 
+	// the initial export runs in the background like PluginButtonClicked, deltas follow once it is complete
+	mLiveSync = std::make_shared<LiveSync>();
+}
+
+bool FactiniariaModule::IsLiveSyncEnabled() const
+{
+	return mLiveSync && mLiveSync->isRunning();
+}
+
+bool FactiniariaModule::IsExporting() const
+{
+	return mExportJob && mExportJob->isRunning();
 }
 
 void FactiniariaModule::AddMenuExtension(FMenuBuilder& Builder)
 {
 	Builder.AddMenuEntry(FactiniariaCommands::Get().PluginAction);
+	Builder.AddMenuEntry(FactiniariaCommands::Get().LiveSyncAction);
 }
 
 void FactiniariaModule::AddToolbarExtension(FToolBarBuilder& Builder)
 {
 	Builder.AddToolBarButton(FactiniariaCommands::Get().PluginAction);
+	Builder.AddToolBarButton(FactiniariaCommands::Get().LiveSyncAction);
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -7,6 +7,7 @@
 void FactiniariaCommands::RegisterCommands()
 {
 	UI_COMMAND(PluginAction, "actiniaria", "Execute actiniaria action", EUserInterfaceActionType::Button, FInputGesture());
+	UI_COMMAND(LiveSyncAction, "actiniaria live sync", "Export the level and keep sending editor changes", EUserInterfaceActionType::ToggleButton, FInputGesture());
 }
 
 #undef LOCTEXT_NAMESPACE
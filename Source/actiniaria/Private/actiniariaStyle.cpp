@@ -47,6 +47,7 @@ TSharedRef< FSlateStyleSet > FactiniariaStyle::Create()
 	Style->SetContentRoot(IPluginManager::Get().FindPlugin("actiniaria")->GetBaseDir() / TEXT("Resources"));
 
 	Style->Set("actiniaria.PluginAction", new IMAGE_BRUSH(TEXT("ButtonIcon_40x"), Icon40x40));
+	Style->Set("actiniaria.LiveSyncAction", new IMAGE_BRUSH(TEXT("ButtonIcon_40x"), Icon40x40));
 
 	return Style;
 }
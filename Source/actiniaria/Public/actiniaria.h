@@ -6,6 +6,9 @@
 #include "Modules/ModuleManager.h"
 #include <thread>
 #include <functional>
+#include <memory>
+
+DECLARE_LOG_CATEGORY_EXTERN(LogActiniaria, Log, All);
 
 class FToolBarBuilder;
 class FMenuBuilder;
@@ -20,6 +23,10 @@ public:
 	
 	/** This function will be bound to Command. */
 	void PluginButtonClicked();
+
+	void LiveSyncClicked();
+	bool IsLiveSyncEnabled() const;
+	bool IsExporting() const;
 	
 private:
 
@@ -28,5 +35,6 @@ private:
 
 private:
 	TSharedPtr<class FUICommandList> PluginCommands;
-	std::shared_ptr<std::thread> mThread;
+	std::shared_ptr<class ExportJob> mExportJob;
+	std::shared_ptr<class LiveSync> mLiveSync;
 };
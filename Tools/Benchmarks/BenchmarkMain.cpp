@@ -0,0 +1,37 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	struct Benchmark
+	{
+		const char* name;
+		bool (*run)(const std::vector<std::string>& args);
+	};
+
+	const Benchmark benchmarks[] =
+	{
+		{ "sharedarena", &benchmarkSharedArena },
+		{ "materialcompiler", &benchmarkMaterialCompiler },
+		{ "textureconversion", &benchmarkTextureConversion },
+		{ "ipcbatching", &benchmarkIPCBatching },
+	};
+}
+
+// usage: actiniaria_bench <benchmark> [args]
+int main(int argc, char** argv)
+{
+	for (auto& benchmark : benchmarks)
+	{
+		if (argc > 1 && strcmp(argv[1], benchmark.name) == 0)
+			return benchmark.run(std::vector<std::string>(argv + 2, argv + argc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	printf("usage: actiniaria_bench <benchmark> [args], benchmarks:");
+	for (auto& benchmark : benchmarks)
+		printf(" %s", benchmark.name);
+	printf("\n");
+	return EXIT_FAILURE;
+}
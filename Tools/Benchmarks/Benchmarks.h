@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// benchmarks of the parts of the plugin without UE dependency, run by hand through actiniaria_bench.
+// args are the arguments after the benchmark name, results are printed. false if the compared paths disagree
+
+inline double getSeconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// args[index] as a number, fallback when it is missing
+inline uint32_t getArg(const std::vector<std::string>& args, size_t index, uint32_t fallback)
+{
+	return index < args.size() ? (uint32_t)strtoul(args[index].c_str(), nullptr, 10) : fallback;
+}
+
+// payloads sent through a pipe and through the shared memory arena between two threads.
+// args: [PayloadKB] [NumPayloads] [ArenaMB]
+bool benchmarkSharedArena(const std::vector<std::string>& args);
+
+// compiles the captured material graphs in a directory serially and in parallel, shaders that differ from the captured
+// ones fail. args: [Directory] [update], update rewrites the captured shaders instead
+bool benchmarkMaterialCompiler(const std::vector<std::string>& args);
+
+// scalar and simd conversion of random pixels from the formats that are not copied. args: [NumPixels]
+bool benchmarkTextureConversion(const std::vector<std::string>& args);
+
+// a synthetic scene message stream written to an unbuffered file directly and through the batch writer.
+// args: [NumActors] [BatchSizeKB]
+bool benchmarkIPCBatching(const std::vector<std::string>& args);
@@ -0,0 +1,66 @@
+#include "Benchmarks.h"
+#include "BatchWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+bool benchmarkIPCBatching(const std::vector<std::string>& args)
+{
+	// a message per actor like createModel, every 64th actor brings a mesh payload, written to an unbuffered file so every sink call is a syscall
+	const uint32_t numActors = getArg(args, 0, 50000);
+	const size_t batchSize = (size_t)getArg(args, 1, 64) << 10;
+	if (numActors == 0)
+		return true;
+
+	std::mt19937 rng(0);
+	std::vector<uint32_t> sizes;
+	for (uint32_t i = 0; i < numActors; ++i)
+	{
+		sizes.push_back(24 + rng() % (320 - 24 + 1));
+		if (i % 64 == 63)
+			sizes.push_back((64 << 10) + rng() % ((1 << 20) - (64 << 10) + 1));
+	}
+	std::vector<char> source(1 << 20);
+	for (auto& c : source)
+		c = (char)rng();
+
+	const std::string path = (std::filesystem::temp_directory_path() / "actiniaria_IPCBatching.bin").string();
+	auto measure = [&](size_t flushSize, uint64_t& sinkWrites)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr)
+			return -1.0;
+		setvbuf(file, nullptr, _IONBF, 0);
+		double start = getSeconds();
+		{
+			BatchWriter writer([file](const void* data, size_t size) { fwrite(data, 1, size, file); }, flushSize, flushSize, std::chrono::milliseconds(10));
+			for (auto size : sizes)
+				writer.write(source.data(), size);
+			writer.flush();
+			sinkWrites = writer.getNumSinkWrites();
+		}
+		fclose(file);
+		return getSeconds() - start;
+	};
+
+	uint64_t directWrites = 0, batchedWrites = 0;
+	const double direct = measure(0, directWrites);
+	const double batched = measure(batchSize, batchedWrites);
+	remove(path.c_str());
+	if (direct < 0 || batched < 0)
+	{
+		printf("cannot write %s\n", path.c_str());
+		return false;
+	}
+
+	uint64_t bytes = 0;
+	for (auto size : sizes)
+		bytes += size;
+	const double mb = bytes / (1024.0 * 1024.0);
+	printf("ipc batching, %u actors, %llu writes, %.1f MB: direct %llu syscalls %.2f ms (%.1f MB/s), batched %u KB %llu syscalls %.2f ms (%.1f MB/s), %.2fx\n",
+		numActors, (unsigned long long)sizes.size(), mb, (unsigned long long)directWrites, direct * 1000.0, mb / std::max(direct, 1e-9),
+		(uint32_t)(batchSize >> 10), (unsigned long long)batchedWrites, batched * 1000.0, mb / std::max(batched, 1e-9), direct / std::max(batched, 1e-9));
+	return true;
+}
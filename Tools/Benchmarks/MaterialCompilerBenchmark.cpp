@@ -0,0 +1,168 @@
+#include "Benchmarks.h"
+#include "MaterialCompiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// a captured graph with the shader generated from it, expected is empty when no shader was captured
+	struct Case
+	{
+		std::string name;
+		MaterialGraph graph;
+		uint32_t options;
+		fs::path shader;
+		std::string expected;
+	};
+
+	bool loadString(std::string& text, const fs::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::ostringstream ss;
+		ss << file.rdbuf();
+		text = ss.str();
+		return true;
+	}
+
+	// options of a shader file named <graph>.<options>.hlsl
+	bool getShaderOptions(const fs::path& shader, const std::string& stem, uint32_t& options)
+	{
+		const std::string name = shader.filename().string();
+		const std::string suffix = ".hlsl";
+		if (name.size() <= stem.size() + 1 + suffix.size() || name.compare(0, stem.size() + 1, stem + ".") != 0 ||
+			name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			return false;
+		const std::string digits = name.substr(stem.size() + 1, name.size() - stem.size() - 1 - suffix.size());
+		if (digits.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		options = (uint32_t)strtoul(digits.c_str(), nullptr, 10);
+		return true;
+	}
+}
+
+bool benchmarkMaterialCompiler(const std::vector<std::string>& args)
+{
+	// graphs and shaders as actiniaria.CaptureMaterialGraphs writes them, every shader is compared with the one
+	// generated from its graph with the options in its name
+	const fs::path directory = args.size() > 0 ? args[0] : ".";
+	const bool update = args.size() > 1 && args[1] == "update";
+	const uint32_t defaultOptions = MaterialCompiler::MO_CommonSubexpressions | MaterialCompiler::MO_ConstantFolding | MaterialCompiler::MO_ParameterBuffers;
+
+	std::error_code ec;
+	std::vector<fs::path> files;
+	for (auto& entry : fs::directory_iterator(directory, ec))
+		files.push_back(entry.path());
+	std::sort(files.begin(), files.end());
+
+	std::vector<Case> cases;
+	bool valid = true;
+	for (auto& path : files)
+	{
+		if (path.extension() != ".graph")
+			continue;
+		std::string text;
+		MaterialGraph graph;
+		if (!loadString(text, path) || !readMaterialGraph(text, graph))
+		{
+			printf("cannot read material graph %s\n", path.string().c_str());
+			valid = false;
+			continue;
+		}
+
+		const std::string stem = path.stem().string();
+		const size_t first = cases.size();
+		for (auto& shader : files)
+		{
+			uint32_t options = 0;
+			if (!getShaderOptions(shader, stem, options))
+				continue;
+			cases.push_back({ stem, graph, options, shader, std::string() });
+			loadString(cases.back().expected, shader);
+		}
+		if (cases.size() == first)
+			cases.push_back({ stem, graph, defaultOptions, fs::path(), std::string() });
+	}
+	if (cases.empty())
+	{
+		printf("no material graphs in %s, run actiniaria.CaptureMaterialGraphs in the editor first\n", directory.string().c_str());
+		return false;
+	}
+
+	// one compiler per graph like an export, the parallel run is what sendQueued does with the pending materials
+	std::vector<std::string> shaders(cases.size());
+	std::vector<uint32_t> evaluations(cases.size());
+	auto compile = [&](size_t i)
+	{
+		MaterialCompiler compiler(cases[i].options);
+		shaders[i] = compiler.compile(cases[i].graph);
+		evaluations[i] = compiler.getNumEvaluations();
+	};
+	auto measure = [&](bool parallel)
+	{
+		double best = 1e30;
+		for (int run = 0; run < 5; ++run)
+		{
+			double start = getSeconds();
+			if (parallel)
+			{
+				std::atomic<size_t> next{ 0 };
+				std::vector<std::thread> workers(std::max(std::thread::hardware_concurrency(), 1u));
+				for (auto& worker : workers)
+				{
+					worker = std::thread([&]()
+					{
+						for (size_t i = next++; i < cases.size(); i = next++)
+							compile(i);
+					});
+				}
+				for (auto& worker : workers)
+					worker.join();
+			}
+			else
+			{
+				for (size_t i = 0; i < cases.size(); ++i)
+					compile(i);
+			}
+			best = std::min(best, getSeconds() - start);
+		}
+		return best * 1000.0;
+	};
+	double serialms = measure(false);
+	double parallelms = measure(true);
+
+	uint64_t bytes = 0;
+	uint64_t expressions = 0;
+	uint32_t compared = 0;
+	uint32_t changed = 0;
+	for (size_t i = 0; i < cases.size(); ++i)
+	{
+		bytes += shaders[i].size();
+		expressions += evaluations[i];
+		if (cases[i].shader.empty())
+			continue;
+		if (update)
+		{
+			std::ofstream(cases[i].shader, std::ios::binary) << shaders[i];
+			continue;
+		}
+		++compared;
+		if (shaders[i] != cases[i].expected)
+		{
+			++changed;
+			printf("%s, options %u: shader differs from the captured one\n", cases[i].name.c_str(), cases[i].options);
+		}
+	}
+	printf("material compiler, %llu shaders: serial %.2f ms, parallel %.2f ms (%.2fx), %llu expressions, %llu bytes of hlsl, %u of %u captured shaders changed\n",
+		(unsigned long long)cases.size(), serialms, parallelms, serialms / std::max(parallelms, 1e-6), (unsigned long long)expressions, (unsigned long long)bytes, changed, compared);
+	return valid && changed == 0;
+}
@@ -0,0 +1,23 @@
+#include "common.hlsl"
+#include "pbr.hlsl"
+__BOUND_RESOURCE__  
+sampler pointSampler:register(s0);
+sampler linearSampler:register(s1);
+sampler linearClamp:register(s2);
+sampler anisotropicSampler:register(s3);
+half4 ps(PSInput input):SV_TARGET 
+{
+	half3 V = normalize(campos.xyz - input.worldPos.xyz);
+	half3 Base_Color = (half4(1,0.5,0.25,0.25));
+	half3 Emissive_Color = ((half4(1,0.5,0.25,0.25)) * (pow((-2),0.5)));
+	half Metallic = (0.25);
+	half Roughness = (1);
+#ifdef HAS_NORMALMAP
+	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);
+#else
+	half3 _normal = input.normal.xyz;
+#endif
+	__SHADER_CONTENT__
+
+}
+
@@ -0,0 +1,34 @@
+#define HAS_NORMALMAP
+#include "common.hlsl"
+#include "pbr.hlsl"
+Texture2DArray _TextureArray_0;
+__BOUND_RESOURCE__  
+sampler pointSampler:register(s0);
+sampler linearSampler:register(s1);
+sampler linearClamp:register(s2);
+sampler anisotropicSampler:register(s3);
+half4 reconstructNormalZ(half4 n)
+{
+	half2 xy = n.rg * 2 - 1;
+	n.b = sqrt(saturate(1 - dot(xy, xy))) * 0.5 + 0.5;
+	return n;
+}
+half4 ps(PSInput input):SV_TARGET 
+{
+	half3 V = normalize(campos.xyz - input.worldPos.xyz);
+	half4 MaterialExpressionTextureSample_1 = _TextureArray_0.Sample(anisotropicSampler,float3(((input.uv * half2(2,2))).xy,0));
+	half4 MaterialExpressionTextureSample_0 = reconstructNormalZ(_TextureArray_0.Sample(anisotropicSampler,float3(((input.uv * half2(2,2))).xy,2)));
+	half3 Base_Color = (MaterialExpressionTextureSample_1);
+	half3 Normal = (MaterialExpressionTextureSample_0);
+	half Roughness = (1 - (MaterialExpressionTextureSample_1.a));
+	half3 Emissive_Color = 0.0f;
+	half Metallic = 0.25;
+#ifdef HAS_NORMALMAP
+	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);
+#else
+	half3 _normal = input.normal.xyz;
+#endif
+	__SHADER_CONTENT__
+
+}
+
@@ -0,0 +1,27 @@
+#include "common.hlsl"
+#include "pbr.hlsl"
+Texture2D _T_Clouds;
+__BOUND_RESOURCE__  
+sampler pointSampler:register(s0);
+sampler linearSampler:register(s1);
+sampler linearClamp:register(s2);
+sampler anisotropicSampler:register(s3);
+half4 ps(PSInput input):SV_TARGET 
+{
+	half3 V = normalize(campos.xyz - input.worldPos.xyz);
+	float2 _t0 = ((input.uv * half2(1,1)) + half2(0.1,0.05) * (fmod(time, 10)));
+	half4 MaterialExpressionTextureSample_0 = _T_Clouds.Sample(anisotropicSampler,_t0);
+	half3 Base_Color = ((input.color).rgb);
+	half3 Emissive_Color = ((MaterialExpressionTextureSample_0) * (clamp(0.51 / (1 - 0.5) * (1.0f - clamp(length((input.worldPos.xyz) - (objpos))/256,0,1.0f)),0,1.0f)));
+	half Opacity = (MaterialExpressionTextureSample_0.a);
+	half Metallic = 0;
+	half Roughness = 0.5;
+#ifdef HAS_NORMALMAP
+	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);
+#else
+	half3 _normal = input.normal.xyz;
+#endif
+	__SHADER_CONTENT__
+
+}
+
@@ -0,0 +1,25 @@
+#include "common.hlsl"
+#include "pbr.hlsl"
+Texture2D _T_Wood_D;
+__BOUND_RESOURCE__  
+sampler pointSampler:register(s0);
+sampler linearSampler:register(s1);
+sampler linearClamp:register(s2);
+sampler anisotropicSampler:register(s3);
+half4 ps(PSInput input):SV_TARGET 
+{
+	half3 V = normalize(campos.xyz - input.worldPos.xyz);
+	half4 MaterialExpressionTextureSample_0 = _T_Wood_D.Sample(anisotropicSampler,input.uv);
+	half3 Base_Color = (((MaterialExpressionTextureSample_0) * (half4(0.8,0.6,0.4,1))) * (1));
+	half3 Emissive_Color = (lerp(((MaterialExpressionTextureSample_0) * (half4(0.8,0.6,0.4,1))),(half4(0.8,0.6,0.4,1)),0));
+	half Roughness = (0.7);
+	half Metallic = 0;
+#ifdef HAS_NORMALMAP
+	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);
+#else
+	half3 _normal = input.normal.xyz;
+#endif
+	__SHADER_CONTENT__
+
+}
+
@@ -0,0 +1,31 @@
+#include "common.hlsl"
+#include "pbr.hlsl"
+Texture2D _T_Wood_D;
+cbuffer MaterialParameters
+{
+	float4 _v_Tint;
+	float _s_Wood_Roughness;
+};
+__BOUND_RESOURCE__  
+sampler pointSampler:register(s0);
+sampler linearSampler:register(s1);
+sampler linearClamp:register(s2);
+sampler anisotropicSampler:register(s3);
+half4 ps(PSInput input):SV_TARGET 
+{
+	half3 V = normalize(campos.xyz - input.worldPos.xyz);
+	half4 MaterialExpressionTextureSample_0 = _T_Wood_D.Sample(anisotropicSampler,input.uv);
+	float4 _t0 = ((MaterialExpressionTextureSample_0) * (_v_Tint));
+	half3 Base_Color = (_t0);
+	half3 Emissive_Color = (_t0);
+	half Roughness = (_s_Wood_Roughness);
+	half Metallic = 0;
+#ifdef HAS_NORMALMAP
+	half3 _normal = calNormal(Normal.xyz, input.normal.xyz, input.tangent.xyz, input.binormal.xyz);
+#else
+	half3 _normal = input.normal.xyz;
+#endif
+	__SHADER_CONTENT__
+
+}
+
@@ -0,0 +1,127 @@
+#include "Benchmarks.h"
+#include "SharedArena.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#if defined(_WIN32)
+#	include <fcntl.h>
+#	include <io.h>
+#	define pipe(fds) _pipe(fds, 1 << 16, _O_BINARY)
+#	define read _read
+#	define write _write
+#	define close _close
+#else
+#	include <unistd.h>
+#endif
+
+bool benchmarkSharedArena(const std::vector<std::string>& args)
+{
+	// the receiver thread sums every byte it gets so both paths touch the payload once on each side
+	const uint32_t payloadSize = std::max(getArg(args, 0, 4096), 1u) << 10;
+	const uint32_t numPayloads = std::max(getArg(args, 1, 64), 1u);
+	const size_t capacity = (size_t)std::max(getArg(args, 2, 256), 1u) << 20;
+	std::vector<char> payload(payloadSize);
+	for (size_t i = 0; i < payload.size(); ++i)
+		payload[i] = (char)(i * 7);
+	const uint64_t total = (uint64_t)payloadSize * numPayloads;
+	const double mb = total / (1024.0 * 1024.0);
+
+	// pipe: the payload bytes go through the kernel
+	double pipeSeconds = 0;
+	uint64_t pipeSum = 0;
+	int fds[2];
+	if (pipe(fds) == 0)
+	{
+		double start = getSeconds();
+		std::thread receiver([&]()
+		{
+			std::vector<uint8_t> bytes(1 << 16);
+			for (uint64_t received = 0; received < total;)
+			{
+				int count = (int)read(fds[0], bytes.data(), (unsigned)bytes.size());
+				if (count <= 0)
+					break;
+				for (int b = 0; b < count; ++b)
+					pipeSum += bytes[b];
+				received += (uint64_t)count;
+			}
+		});
+		for (uint32_t i = 0; i < numPayloads; ++i)
+		{
+			for (uint32_t sent = 0; sent < payloadSize;)
+			{
+				int written = (int)write(fds[1], payload.data() + sent, payloadSize - sent);
+				if (written <= 0)
+					break;
+				sent += (uint32_t)written;
+			}
+		}
+		close(fds[1]);
+		receiver.join();
+		close(fds[0]);
+		pipeSeconds = getSeconds() - start;
+	}
+
+	// arena: the payload is copied once into shared memory, only descriptors are handed over
+	double arenaSeconds = 0;
+	uint64_t arenaSum = 0;
+	SharedArena writer, reader;
+	const std::string name = "actiniaria_benchmark_" + std::to_string(std::random_device()());
+	if (payloadSize <= capacity && writer.create(name, capacity) && reader.open(name))
+	{
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<SharedArena::Descriptor> queue;
+		bool done = false;
+		double start = getSeconds();
+		std::thread receiver([&]()
+		{
+			for (;;)
+			{
+				SharedArena::Descriptor desc;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					ready.wait(lock, [&]() { return done || !queue.empty(); });
+					if (queue.empty())
+						return;
+					desc = queue.front();
+					queue.pop_front();
+				}
+				const uint8_t* data = (const uint8_t*)reader.data(desc);
+				for (uint32_t b = 0; b < desc.size; ++b)
+					arenaSum += data[b];
+				reader.release(desc);
+			}
+		});
+		for (uint32_t i = 0; i < numPayloads; ++i)
+		{
+			SharedArena::Descriptor desc;
+			char* dst = writer.acquire(payloadSize, SharedArena::PT_Vertices, desc, 10000);
+			if (dst == nullptr)
+				break;
+			memcpy(dst, payload.data(), payloadSize);
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(desc);
+			ready.notify_one();
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+			ready.notify_one();
+		}
+		receiver.join();
+		arenaSeconds = getSeconds() - start;
+	}
+
+	printf("payload transport, %u x %u KB: pipe %.1f MB/s, shared arena %u MB %.1f MB/s (%.2fx), checksums %s\n",
+		numPayloads, payloadSize >> 10, mb / std::max(pipeSeconds, 1e-9), (uint32_t)(capacity >> 20), mb / std::max(arenaSeconds, 1e-9),
+		pipeSeconds / std::max(arenaSeconds, 1e-9), pipeSum == arenaSum ? "match" : "differ");
+	return pipeSum == arenaSum;
+}
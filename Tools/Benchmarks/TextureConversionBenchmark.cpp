@@ -0,0 +1,50 @@
+#include "Benchmarks.h"
+#include "TextureConverter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+bool benchmarkTextureConversion(const std::vector<std::string>& args)
+{
+	const uint32_t numPixels = getArg(args, 0, 1u << 22);
+	if (numPixels == 0)
+		return true;
+
+	std::mt19937 rng(0);
+	std::vector<uint8_t> src((size_t)numPixels * 4);
+	for (auto& b : src)
+		b = (uint8_t)rng();
+
+	size_t totalMismatches = 0;
+	for (auto format : { TextureConverter::SF_RGBA8, TextureConverter::SF_BGRE8, TextureConverter::SF_RGBE8 })
+	{
+		TextureConverter converter(format);
+		std::vector<uint8_t> scalar((size_t)numPixels * converter.getTargetBytesPerPixel());
+		std::vector<uint8_t> simd(scalar.size());
+
+		auto measure = [&](std::vector<uint8_t>& dst, bool usesimd)
+		{
+			double best = 1e30;
+			for (int run = 0; run < 5; ++run)
+			{
+				double start = getSeconds();
+				converter.convert(src.data(), dst.data(), numPixels, usesimd);
+				best = std::min(best, getSeconds() - start);
+			}
+			return best * 1000.0;
+		};
+
+		double scalarms = measure(scalar, false);
+		double simdms = measure(simd, true);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < scalar.size(); ++i)
+			mismatches += scalar[i] != simd[i];
+		totalMismatches += mismatches;
+
+		printf("texture conversion %u, %u pixels: scalar %.2f ms, simd %.2f ms (%.2fx), %llu mismatched bytes\n",
+			(uint32_t)format, numPixels, scalarms, simdms, scalarms / std::max(simdms, 1e-6), (unsigned long long)mismatches);
+	}
+	return totalMismatches == 0;
+}
@@ -0,0 +1,64 @@
+#include "Tests.h"
+#include "BatchWriter.h"
+
+#include <random>
+#include <vector>
+
+bool testBatchWriter(uint32_t runs, uint32_t seed, std::string& error)
+{
+	std::mt19937 rng(seed);
+	for (uint32_t run = 0; run < runs; ++run)
+	{
+		// every fourth run passes writes through, the latency is long enough to never trigger
+		const size_t flushSize = run % 4 == 0 ? 0 : 1 + rng() % 4096;
+		const size_t bypassSize = 1 + rng() % 8192;
+		const std::string name = "run " + std::to_string(run) + " flush " + std::to_string(flushSize) + " bypass " + std::to_string(bypassSize);
+
+		std::vector<char> expected;
+		std::vector<char> received;
+		uint64_t sinkCalls = 0;
+		bool heldBack = false;
+		uint32_t numWrites = 1 + rng() % 200;
+		{
+			BatchWriter writer([&](const void* data, size_t size)
+			{
+				++sinkCalls;
+				received.insert(received.end(), (const char*)data, (const char*)data + size);
+			}, flushSize, bypassSize, std::chrono::hours(1));
+
+			for (uint32_t i = 0; i < numWrites; ++i)
+			{
+				std::vector<char> data(rng() % 3 == 0 ? rng() % 10000 : rng() % 64);
+				for (auto& c : data)
+					c = (char)rng();
+				expected.insert(expected.end(), data.begin(), data.end());
+				writer.write(data.data(), data.size());
+			}
+			if (writer.getNumBytes() != expected.size() || writer.getNumWrites() != numWrites || writer.getNumSinkWrites() != sinkCalls)
+			{
+				error = name + ": counters do not match the writes";
+				return false;
+			}
+			// less than flushSize bytes stay with the writer until it is flushed
+			heldBack = flushSize != 0 && expected.size() - received.size() >= flushSize;
+		}
+
+		// the destructor flushes
+		if (received != expected)
+		{
+			error = name + ": the sink received other bytes or another order than written";
+			return false;
+		}
+		if (heldBack)
+		{
+			error = name + ": a full buffer was held back";
+			return false;
+		}
+		if (sinkCalls > numWrites)
+		{
+			error = name + ": " + std::to_string(sinkCalls) + " sink calls for " + std::to_string(numWrites) + " writes";
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,148 @@
+#include "Tests.h"
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	void from565(uint16_t c, int* rgb)
+	{
+		const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		rgb[0] = r << 3 | r >> 2;
+		rgb[1] = g << 2 | g >> 4;
+		rgb[2] = b << 3 | b >> 2;
+	}
+
+	// reference decoders, rgba and values receive the 16 pixels of the block
+	void decodeBC1(const uint8_t* block, uint8_t* rgba)
+	{
+		const uint16_t c0 = (uint16_t)(block[0] | block[1] << 8);
+		const uint16_t c1 = (uint16_t)(block[2] | block[3] << 8);
+		int palette[4][3];
+		from565(c0, palette[0]);
+		from565(c1, palette[1]);
+		for (int k = 0; k < 3; ++k)
+		{
+			palette[2][k] = c0 > c1 ? (2 * palette[0][k] + palette[1][k]) / 3 : (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = c0 > c1 ? (palette[0][k] + 2 * palette[1][k]) / 3 : 0;
+		}
+		const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+				rgba[i * 4 + k] = (uint8_t)palette[(indices >> (i * 2)) & 3][k];
+			rgba[i * 4 + 3] = 255;
+		}
+	}
+
+	void decodeBC4(const uint8_t* block, uint8_t* values)
+	{
+		int palette[8] = { block[0], block[1] };
+		for (int i = 1; i < 7; ++i)
+		{
+			if (block[0] > block[1])
+				palette[i + 1] = ((7 - i) * block[0] + i * block[1]) / 7;
+			else if (i < 5)
+				palette[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5;
+			else
+				palette[i + 1] = i == 5 ? 0 : 255;
+		}
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (uint64_t)block[2 + i] << (i * 8);
+		for (int i = 0; i < 16; ++i)
+			values[i] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+	}
+
+	int getMaxError(const uint8_t* a, const uint8_t* b, size_t count, size_t stride, size_t channels)
+	{
+		int error = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (size_t k = 0; k < channels; ++k)
+				error = std::max(error, std::abs(a[i * stride + k] - b[i * stride + k]));
+		}
+		return error;
+	}
+}
+
+bool testBlockCompressor(uint32_t blocks, uint32_t seed, std::string& error)
+{
+	std::mt19937 rng(seed);
+	auto random = [&rng](int n) { return (int)(rng() % (uint32_t)n); };
+
+	for (uint32_t index = 0; index < blocks; ++index)
+	{
+		// a gradient between two colors, every fourth block is solid. the bounds are the palette spacing plus 565 rounding
+		uint8_t rgba[64];
+		int from[4], to[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			from[k] = random(256);
+			to[k] = index % 4 == 0 ? from[k] : random(256);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int k = 0; k < 4; ++k)
+				rgba[i * 4 + k] = (uint8_t)(from[k] + (to[k] - from[k]) * i / 15);
+		}
+
+		uint8_t block[8];
+		uint8_t decoded[64];
+		BlockCompressor::encodeBC1(rgba, block);
+		decodeBC1(block, decoded);
+		int range = 0;
+		for (int k = 0; k < 3; ++k)
+			range = std::max(range, std::abs(to[k] - from[k]));
+		int bound = range / 6 + 9;
+		if (getMaxError(rgba, decoded, 16, 4, 3) > bound)
+		{
+			error = "bc1 block " + std::to_string(index) + " is off by " + std::to_string(getMaxError(rgba, decoded, 16, 4, 3)) + ", bound " + std::to_string(bound);
+			return false;
+		}
+
+		uint8_t alpha[16];
+		uint8_t decodedAlpha[16];
+		for (int i = 0; i < 16; ++i)
+			alpha[i] = rgba[i * 4 + 3];
+		BlockCompressor::encodeBC4(alpha, block);
+		decodeBC4(block, decodedAlpha);
+		bound = std::abs(to[3] - from[3]) / 14 + 1;
+		if (getMaxError(alpha, decodedAlpha, 16, 1, 1) > bound)
+		{
+			error = "bc4 block " + std::to_string(index) + " is off by " + std::to_string(getMaxError(alpha, decodedAlpha, 16, 1, 1)) + ", bound " + std::to_string(bound);
+			return false;
+		}
+	}
+
+	// edge blocks of an image that is not a multiple of 4 repeat its last pixels, a solid image stays solid
+	const uint32_t width = 5, height = 3;
+	std::vector<uint8_t> bgra(width * height * 4);
+	for (size_t i = 0; i < bgra.size(); i += 4)
+	{
+		bgra[i + 0] = 255;
+		bgra[i + 1] = 0;
+		bgra[i + 2] = 0;
+		bgra[i + 3] = 255;
+	}
+	BlockCompressor compressor(BlockCompressor::BC1);
+	std::vector<uint8_t> encoded(compressor.getRowSize(width) * BlockCompressor::getNumBlocks(height));
+	compressor.compress(bgra.data(), width, height, 0, BlockCompressor::getNumBlocks(height), encoded.data());
+	for (size_t offset = 0; offset < encoded.size(); offset += 8)
+	{
+		uint8_t decoded[64];
+		decodeBC1(encoded.data() + offset, decoded);
+		for (int i = 0; i < 16; ++i)
+		{
+			if (decoded[i * 4 + 0] != 0 || decoded[i * 4 + 1] != 0 || decoded[i * 4 + 2] != 255)
+			{
+				error = "edge block at " + std::to_string(offset) + " is not the solid blue of the image";
+				return false;
+			}
+		}
+	}
+	return true;
+}
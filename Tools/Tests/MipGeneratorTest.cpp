@@ -0,0 +1,72 @@
+#include "Tests.h"
+#include "MipGenerator.h"
+
+#include <random>
+#include <vector>
+
+bool testMipGenerator(uint32_t images, uint32_t seed, std::string& error)
+{
+	std::mt19937 rng(seed);
+	auto random = [&rng](uint32_t n) { return (uint32_t)(rng() % n); };
+	const MipGenerator::PixelFormat formats[] = { MipGenerator::PF_R8, MipGenerator::PF_R16, MipGenerator::PF_BGRA8, MipGenerator::PF_RGBA16, MipGenerator::PF_RGBA16F };
+
+	for (uint32_t index = 0; index < images; ++index)
+	{
+		const MipGenerator::PixelFormat format = formats[random(5)];
+		const bool srgb = format == MipGenerator::PF_BGRA8 && random(2) == 0;
+		const bool solid = random(4) == 0;
+		const uint32_t width = 1 + random(67);
+		const uint32_t height = 1 + random(67);
+		const uint32_t bpp = MipGenerator::getBytesPerPixel(format);
+		const std::string name = "image " + std::to_string(index) + " format " + std::to_string((uint32_t)format) + " " +
+			std::to_string(width) + "x" + std::to_string(height);
+
+		// half floats are kept finite, the filter does not need to agree on nan payloads
+		std::vector<uint8_t> src((size_t)width * height * bpp);
+		for (size_t i = 0; i < src.size(); ++i)
+			src[i] = solid ? src[i % bpp] : (uint8_t)random(256);
+		if (format == MipGenerator::PF_RGBA16F)
+		{
+			for (size_t i = 0; i < src.size(); i += 2)
+			{
+				const uint16_t h = MipGenerator::floatToHalf(solid ? 0.75f : (float)random(20000) / 100.0f);
+				src[i] = (uint8_t)h;
+				src[i + 1] = (uint8_t)(h >> 8);
+			}
+		}
+
+		// the whole mip with the scalar filter against row ranges with the simd one
+		const uint32_t dstWidth = MipGenerator::getMipSize(width, 1);
+		const uint32_t dstHeight = MipGenerator::getMipSize(height, 1);
+		const size_t rowSize = (size_t)dstWidth * bpp;
+		std::vector<uint8_t> scalar(rowSize * dstHeight);
+		std::vector<uint8_t> simd(scalar.size());
+		MipGenerator generator(format, srgb);
+		generator.downsample(src.data(), width, height, 0, dstHeight, scalar.data(), false);
+		for (uint32_t row = 0; row < dstHeight;)
+		{
+			const uint32_t rows = 1 + random(dstHeight - row);
+			generator.downsample(src.data(), width, height, row, rows, simd.data() + row * rowSize, true);
+			row += rows;
+		}
+		if (scalar != simd)
+		{
+			error = name + ": simd and scalar filter differ";
+			return false;
+		}
+
+		// a solid image keeps its color through the srgb round trip
+		if (solid)
+		{
+			for (size_t i = 0; i < scalar.size(); ++i)
+			{
+				if (scalar[i] != src[i % bpp])
+				{
+					error = name + ": a solid image changed its color at byte " + std::to_string(i);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
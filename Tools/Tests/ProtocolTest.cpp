@@ -0,0 +1,214 @@
+#include "Tests.h"
+#include "Protocol.h"
+
+#include <cstring>
+#include <random>
+#include <utility>
+
+namespace
+{
+	enum FieldType
+	{
+		FT_U8,
+		FT_U32,
+		FT_U64,
+		FT_Float,
+		FT_String,
+		FT_Name,
+		FT_Bytes,
+		FT_Count
+	};
+
+	struct Field
+	{
+		FieldType type;
+		uint64_t value;
+		std::string str;
+	};
+
+	struct Message
+	{
+		Opcode opcode;
+		std::vector<Field> fields;
+	};
+
+	// splits the output of an encoder into frames without their size prefix, false if the sizes do not add up
+	bool splitFrames(const std::vector<char>& data, std::vector<std::pair<const char*, size_t>>& frames)
+	{
+		size_t pos = 0;
+		while (pos < data.size())
+		{
+			uint32_t size = 0;
+			if (data.size() - pos < sizeof(size))
+				return false;
+			memcpy(&size, data.data() + pos, sizeof(size));
+			pos += sizeof(size);
+			if (data.size() - pos < size)
+				return false;
+			frames.emplace_back(data.data() + pos, size);
+			pos += size;
+		}
+		return true;
+	}
+
+	// reads the fields of a message the way a handler would, false if a value differs
+	bool readMessage(ProtocolDecoder& decoder, const Message& message)
+	{
+		for (auto& field : message.fields)
+		{
+			uint64_t value = 0;
+			std::string str;
+			std::vector<char> bytes;
+			switch (field.type)
+			{
+			case FT_U8: { uint8_t v; decoder >> v; value = v; break; }
+			case FT_U32: { uint32_t v; decoder >> v; value = v; break; }
+			case FT_U64: decoder >> value; break;
+			case FT_Float: { float v; decoder >> v; uint32_t bits; memcpy(&bits, &v, sizeof(bits)); value = bits; break; }
+			case FT_String: decoder >> str; break;
+			case FT_Name: decoder.readName(str); break;
+			case FT_Bytes: decoder.readBytes(bytes); str.assign(bytes.begin(), bytes.end()); break;
+			default: return false;
+			}
+			if (value != field.value || str != field.str)
+				return false;
+		}
+		return true;
+	}
+}
+
+bool testProtocol(uint32_t iterations, uint32_t seed, std::string& error)
+{
+	std::mt19937 rng(seed);
+	auto random = [&rng](uint32_t n) { return (uint32_t)(rng() % n); };
+	auto randomString = [&](uint32_t maxLength)
+	{
+		std::string str(random(maxLength + 1), 0);
+		for (char& c : str)
+			c = (char)random(256);
+		return str;
+	};
+
+	// a small pool so names repeat and most messages only refer to ids defined earlier
+	std::vector<std::string> namePool(64);
+	for (auto& name : namePool)
+		name = randomString(24);
+
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+	{
+		ProtocolEncoder encoder;
+		std::vector<Message> messages(1 + random(16));
+		for (auto& message : messages)
+		{
+			message.opcode = (Opcode)(OP_Transport + random(OP_Count - OP_Transport));
+			encoder.begin(message.opcode);
+			message.fields.resize(random(12));
+			for (auto& field : message.fields)
+			{
+				field.type = (FieldType)random(FT_Count);
+				field.value = 0;
+				switch (field.type)
+				{
+				case FT_U8: field.value = random(256); encoder << (uint8_t)field.value; break;
+				case FT_U32: field.value = rng(); encoder << (uint32_t)field.value; break;
+				case FT_U64: field.value = ((uint64_t)rng() << 32) | rng(); encoder << field.value; break;
+				case FT_Float:
+				{
+					uint32_t bits = rng();
+					float v;
+					memcpy(&v, &bits, sizeof(v));
+					// nan payloads survive a memcpy but keep the comparison simple
+					if (v != v)
+						v = 0, bits = 0;
+					field.value = bits;
+					encoder << v;
+					break;
+				}
+				case FT_String: field.str = randomString(40); encoder << field.str; break;
+				case FT_Name: field.str = namePool[random((uint32_t)namePool.size())]; encoder.writeName(field.str); break;
+				case FT_Bytes: field.str = randomString(200); encoder.writeBytes(field.str.data(), (uint32_t)field.str.size()); break;
+				default: break;
+				}
+			}
+			encoder.end();
+		}
+
+		// round trip, every message decodes to the fields it was built from and nothing more
+		std::vector<std::pair<const char*, size_t>> frames;
+		if (!splitFrames(encoder.getFrames(), frames))
+		{
+			error = "frame sizes do not add up in iteration " + std::to_string(iteration);
+			return false;
+		}
+		ProtocolDecoder decoder;
+		size_t next = 0;
+		for (auto& frame : frames)
+		{
+			if (!decoder.decode(frame.first, frame.second))
+			{
+				error = "frame rejected in iteration " + std::to_string(iteration);
+				return false;
+			}
+			if (decoder.getOpcode() == OP_DefineNames)
+				continue;
+			if (next == messages.size() || decoder.getOpcode() != messages[next].opcode ||
+				!readMessage(decoder, messages[next]) || !decoder.isComplete())
+			{
+				error = "message " + std::to_string(next) + " differs in iteration " + std::to_string(iteration);
+				return false;
+			}
+			++next;
+		}
+		if (next != messages.size() || decoder.getNumNames() != encoder.getNumNames())
+		{
+			error = "messages or names missing in iteration " + std::to_string(iteration);
+			return false;
+		}
+
+		// truncated messages never read as complete
+		ProtocolDecoder truncated;
+		next = 0;
+		for (auto& frame : frames)
+		{
+			if (!truncated.decode(frame.first, frame.second) || truncated.getOpcode() == OP_DefineNames)
+				continue;
+			const Message& message = messages[next++];
+			if (frame.second <= sizeof(uint16_t))
+				continue;
+			truncated.decode(frame.first, sizeof(uint16_t) + random((uint32_t)(frame.second - sizeof(uint16_t))));
+			readMessage(truncated, message);
+			if (truncated.isComplete())
+			{
+				error = "truncated message " + std::to_string(next - 1) + " decoded in iteration " + std::to_string(iteration);
+				return false;
+			}
+		}
+
+		// corrupted bytes may decode to anything but are only read within the frame
+		std::vector<char> corrupt = encoder.getFrames();
+		for (uint32_t i = 0, n = 1 + random(8); i < n; ++i)
+			corrupt[random((uint32_t)corrupt.size())] = (char)random(256);
+		frames.clear();
+		splitFrames(corrupt, frames);
+		ProtocolDecoder fuzzed;
+		for (auto& frame : frames)
+		{
+			if (!fuzzed.decode(frame.first, frame.second) || fuzzed.getOpcode() == OP_DefineNames)
+				continue;
+			for (int read = 0; read < 16 && fuzzed.isValid(); ++read)
+			{
+				std::string str;
+				std::vector<char> bytes;
+				uint64_t value;
+				switch (random(4))
+				{
+				case 0: fuzzed >> value; break;
+				case 1: fuzzed >> str; break;
+				case 2: fuzzed.readName(str); break;
+				default: fuzzed.readBytes(bytes); break;
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#include "Tests.h"
+#include "SharedArena.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+static uint8_t patternByte(uint32_t payload, uint32_t i)
+{
+	return (uint8_t)(payload * 131 + i * 7 + (i >> 8));
+}
+
+bool testSharedArena(uint32_t payloads, uint32_t seed, std::string& error)
+{
+	const size_t capacity = 1024;
+	const std::string name = "actiniaria_verify_" + std::to_string(seed) + "_" + std::to_string(std::random_device()());
+	SharedArena writer, reader;
+	if (!writer.create(name, capacity) || !reader.open(name))
+	{
+		error = "could not create and open " + name;
+		return false;
+	}
+
+	// a drained ring takes a payload that has to skip to the next lap without waiting
+	SharedArena::Descriptor desc;
+	for (uint32_t size : { 400U, 593U, 1024U, 1U, 1024U })
+	{
+		if (writer.acquire(size, 0, desc, 0) == nullptr)
+		{
+			error = "a drained ring did not take " + std::to_string(size) + " bytes";
+			return false;
+		}
+		reader.release(desc);
+	}
+	if (writer.acquire((uint32_t)capacity + 1, 0, desc, 0) != nullptr)
+	{
+		error = "a payload larger than the ring was accepted";
+		return false;
+	}
+
+	// writer and receiver threads, descriptors go through a queue standing in for the control channel
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<SharedArena::Descriptor> queue;
+	bool done = false;
+	std::string readerError;
+	std::thread receiver([&]()
+	{
+		for (;;)
+		{
+			SharedArena::Descriptor received;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait(lock, [&]() { return done || !queue.empty(); });
+				if (queue.empty())
+					return;
+				received = queue.front();
+				queue.pop_front();
+			}
+			const uint8_t* data = (const uint8_t*)reader.data(received);
+			for (uint32_t i = 0; i < received.size && readerError.empty(); ++i)
+			{
+				if (data[i] != patternByte(received.type, i))
+					readerError = "payload " + std::to_string(received.type) + " differs at byte " + std::to_string(i);
+			}
+			reader.release(received);
+		}
+	});
+
+	std::mt19937 rng(seed);
+	for (uint32_t index = 0; index < payloads; ++index)
+	{
+		uint32_t size = 1 + rng() % (uint32_t)capacity;
+		char* dst = writer.acquire(size, index, desc, 1000);
+		if (dst == nullptr)
+		{
+			error = "payload " + std::to_string(index) + " of " + std::to_string(size) + " bytes timed out";
+			break;
+		}
+		for (uint32_t i = 0; i < size; ++i)
+			dst[i] = (char)patternByte(index, i);
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(desc);
+		ready.notify_one();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		ready.notify_one();
+	}
+	receiver.join();
+
+	if (error.empty())
+		error = readerError;
+	return error.empty();
+}
@@ -0,0 +1,55 @@
+#include "Tests.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	struct Test
+	{
+		const char* name;
+		bool (*run)(uint32_t count, uint32_t seed, std::string& error);
+		uint32_t count;
+	};
+
+	const Test tests[] =
+	{
+		{ "protocol", &testProtocol, 1000 },
+		{ "sharedarena", &testSharedArena, 100000 },
+		{ "blockcompressor", &testBlockCompressor, 100000 },
+		{ "mipgenerator", &testMipGenerator, 2000 },
+		{ "textureconverter", &testTextureConverter, 2000 },
+		{ "batchwriter", &testBatchWriter, 300 },
+	};
+}
+
+// usage: actiniaria_tests [test] [count] [seed], every test when none is named
+int main(int argc, char** argv)
+{
+	const char* name = argc > 1 ? argv[1] : nullptr;
+	const uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 0;
+	int failed = 0;
+	int run = 0;
+	for (auto& test : tests)
+	{
+		if (name && strcmp(name, test.name) != 0)
+			continue;
+		const uint32_t count = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : test.count;
+		std::string error;
+		++run;
+		if (test.run(count, seed, error))
+			printf("%s passed, %u cases\n", test.name, count);
+		else
+		{
+			printf("%s failed: %s\n", test.name, error.c_str());
+			++failed;
+		}
+	}
+	if (run == 0)
+	{
+		printf("unknown test %s\n", name);
+		return EXIT_FAILURE;
+	}
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
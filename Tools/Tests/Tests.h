@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// checks of the parts of the plugin without UE dependency, run by ctest through actiniaria_tests.
+// count is the number of random cases, the same seed repeats a run. false with a description of the first failure
+
+// encodes random messages, decodes them again and feeds corrupted frames to the decoder
+bool testProtocol(uint32_t iterations, uint32_t seed, std::string& error);
+
+// loopback of the ring with a writer and a receiver thread in this process: wrapping payloads on a drained ring,
+// then random sized payloads whose content is compared
+bool testSharedArena(uint32_t payloads, uint32_t seed, std::string& error);
+
+// bc1 and bc4 blocks of random gradients decoded by a reference decoder stay within the palette spacing,
+// edge blocks of an odd sized image repeat its pixels
+bool testBlockCompressor(uint32_t blocks, uint32_t seed, std::string& error);
+
+// random images of every pixel format downsampled by the simd filter in row ranges and by the scalar filter in one go
+// give the same bytes, solid images keep their color
+bool testMipGenerator(uint32_t images, uint32_t seed, std::string& error);
+
+// every source format converted by the simd and the scalar path gives the same bytes, plain layouts are copied and
+// RGBA8 is swizzled to BGRA8
+bool testTextureConverter(uint32_t runs, uint32_t seed, std::string& error);
+
+// random writes through writers with random flush and bypass sizes reach the sink complete and in order,
+// in no more sink calls than writes
+bool testBatchWriter(uint32_t runs, uint32_t seed, std::string& error);
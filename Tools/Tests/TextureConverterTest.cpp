@@ -0,0 +1,52 @@
+#include "Tests.h"
+#include "TextureConverter.h"
+
+#include <random>
+#include <vector>
+
+bool testTextureConverter(uint32_t runs, uint32_t seed, std::string& error)
+{
+	std::mt19937 rng(seed);
+	const TextureConverter::SourceFormat formats[] = { TextureConverter::SF_G8, TextureConverter::SF_G16, TextureConverter::SF_BGRA8,
+		TextureConverter::SF_RGBA8, TextureConverter::SF_BGRE8, TextureConverter::SF_RGBE8, TextureConverter::SF_RGBA16, TextureConverter::SF_RGBA16F };
+
+	for (uint32_t run = 0; run < runs; ++run)
+	{
+		// odd counts leave a tail after the last full simd batch
+		const TextureConverter::SourceFormat format = formats[rng() % 8];
+		const size_t count = 1 + rng() % 300;
+		const std::string name = "run " + std::to_string(run) + " format " + std::to_string((uint32_t)format) + " " + std::to_string(count) + " pixels";
+		TextureConverter converter(format);
+		std::vector<uint8_t> src(count * TextureConverter::getBytesPerPixel(format));
+		for (auto& b : src)
+			b = (uint8_t)rng();
+
+		std::vector<uint8_t> scalar(count * converter.getTargetBytesPerPixel());
+		std::vector<uint8_t> simd(scalar.size());
+		converter.convert(src.data(), scalar.data(), count, false);
+		converter.convert(src.data(), simd.data(), count, true);
+		if (scalar != simd)
+		{
+			error = name + ": simd and scalar conversion differ";
+			return false;
+		}
+
+		if (converter.isCopy() && scalar != src)
+		{
+			error = name + ": a plain layout was not copied";
+			return false;
+		}
+		if (format == TextureConverter::SF_RGBA8)
+		{
+			for (size_t i = 0; i < count * 4; i += 4)
+			{
+				if (scalar[i] != src[i + 2] || scalar[i + 1] != src[i + 1] || scalar[i + 2] != src[i] || scalar[i + 3] != src[i + 3])
+				{
+					error = name + ": pixel " + std::to_string(i / 4) + " is not swizzled to BGRA";
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}